@@ -20,11 +20,35 @@ df = pd.read_csv("results.csv")
 # --------------------------------------------------
 plt.figure()  # Create a new figure window
 
-# Plot sequential execution time
-plt.plot(df["size"], df["seq_time"], marker="o", label="Sequential")
-
-# Plot parallel execution time
-plt.plot(df["size"], df["par_time"], marker="o", label="Parallel")
+# The driver writes one row per parallel backend and size (fork, threads,
+# dag, prefork, or fork-<strategy> under -C); older CSV files have no
+# backend column and hold a single backend
+if "backend" not in df.columns:
+    df["backend"] = "fork"
+
+# -N adds a numa_policy column and one "bandwidth" row per memory node;
+# runs with different policies get their own line
+if "numa_policy" not in df.columns:
+    df["numa_policy"] = "first-touch"
+bandwidth = df[df["backend"] == "bandwidth"]
+
+# -S, -F, -R and -L add rows that compare other things than the backends
+# (batch, fixed, multi / stream, create-<strategy>); they are not plotted here
+benchmarks = df["backend"].isin(["bandwidth", "batch", "fixed", "multi", "stream"]) | \
+             df["backend"].str.startswith("create-")
+df = df[~benchmarks].copy()
+df["run"] = df["backend"]
+if df["numa_policy"].nunique() > 1:
+    df["run"] = df["backend"] + " / " + df["numa_policy"]
+runs = df.groupby("run", sort=False)
+
+# Plot sequential execution time (shared by all backends of a size)
+seq = df.drop_duplicates("size")
+plt.plot(seq["size"], seq["seq_time"], marker="o", label="Sequential")
+
+# Plot parallel execution time of each backend
+for name, run in runs:
+    plt.plot(run["size"], run["par_time"], marker="o", label=f"Parallel ({name})")
 
 # Add labels and title
 plt.xlabel("Matrix Size (n)")
@@ -45,8 +69,10 @@ plt.savefig("result/time_vs_size.png", dpi=200)
 # --------------------------------------------------
 plt.figure()  # New figure for second graph
 
-# Plot speedup values
-plt.plot(df["size"], df["speedup"], marker="o")
+# Plot speedup values of each backend
+for name, run in runs:
+    plt.plot(run["size"], run["speedup"], marker="o", label=name)
+plt.legend()
 
 # Add labels and title
 plt.xlabel("Matrix Size (n)")
@@ -60,6 +86,21 @@ plt.grid(True)
 plt.savefig("result/speedup_vs_size.png", dpi=200)
 
 
+# --------------------------------------------------
+# GRAPH 3: Read bandwidth of every NUMA node (-N only)
+# size is the buffer in MiB, par_time the best pass
+# --------------------------------------------------
+if not bandwidth.empty:
+    plt.figure()
+    gbps = bandwidth["size"] * 2**20 / bandwidth["par_time"] / 1e9
+    labels = [f"node {int(k)} ({p})" for k, p in zip(bandwidth["numa_node"], bandwidth["numa_policy"])]
+    plt.bar(labels, gbps)
+    plt.ylabel("Read bandwidth (GB/s)")
+    plt.title("Memory Bandwidth per NUMA Node")
+    plt.grid(True, axis="y")
+    plt.savefig("result/numa_bandwidth.png", dpi=200)
+
+
 # --------------------------------------------------
 # Confirmation message
 # --------------------------------------------------
@@ -10,13 +10,50 @@
  * The performance results are written into a CSV file for analysis and graph plotting.
  *
  * USAGE:
- *      ./final size1 size2 size3 ...
+ *      ./final [options] size1 size2 size3 ...
  * Example:
  *      ./final 200 400 600 800
  *
+ * OPTIONS:
+ *      -b block    Panel width of the blocked LU used by calcDet (default 64)
+ *      -k kernel   Force a SIMD kernel set: scalar, sse2, avx2, avx512 (default: CPUID)
+ *      -m mode     cramer (one determinant per unknown, default), lu (one factorization)
+ *                  rank1 (Cramer loop with det(Ai) from rank-one updates of A's LU)
+ *                  exact (Cramer loop with exact integer determinants, Bareiss)
+ *                  modular (the same exact results from residues modulo many primes)
+ *                  or mixed (float LU, refined to double accuracy; see MIXED-PRECISION)
+ *      -p procs    Worker processes / threads in the parallel solver (default: online CPUs)
+ *      -B backend  Parallel backend: fork (default), threads, dag, prefork (fork once, reuse
+ *                  the workers for every size), both (fork + threads), all
+ *      -t threads  Threads inside one determinant (default 1; 0 = pool size)
+ *      -d          Run threaded determinants as a task DAG on the work-stealing scheduler
+ *      -P pivot    Pivoting in the LU: none, partial (default), complete or rook
+ *      -S count    Solve `count` systems of each size as one SIMD batch (backend "batch")
+ *      -R rhs      Solve `rhs` right-hand sides per size with one factorization
+ *                  (backends "multi" and "stream")
+ *      -F count    Time `count` sequential solves per size with and without the
+ *                  fixed-size kernels for n ≤ 16, in ns per system (backend "fixed")
+ *      -C create   How fork / prefork create workers: fork (default), vfork (+ exec),
+ *                  spawn (posix_spawn) or clone (clone3 without sharing flags)
+ *      -L reps     Time `reps` bare process creations per size with every -C
+ *                  strategy (backends "create-fork" ... "create-clone")
+ *      -A policy   Pin worker w to a CPU: none (default), compact, scatter,
+ *                  physical or nosmt (see WORKER POOLS AND THREAD TEAM)
+ *      -N          NUMA policies: interleave A and other shared matrices, keep
+ *                  scratch on its worker's node; prints the read bandwidth of
+ *                  every memory node first (see MATRIX MEMORY MANAGEMENT)
+ *      -T          Run the self-checks against known answers and exit (no sizes);
+ *                  the exit status is non-zero if one fails
+ *
  * OUTPUT:
  *      results.csv → Contains:
- *          Matrix Size, Sequential Time, Parallel Time, Speedup
+ *          Matrix Size, Sequential Time, Parallel Time, Speedup (wall clock),
+ *          Max difference between the sequential and parallel solutions,
+ *          CPU time of the sequential run, of the parallel parent and of its children,
+ *          Parallel backend, refinement steps (-m mixed; −1 = fell back to double),
+ *          backward error ‖B − A·X‖ / (‖A‖·‖X‖ + ‖B‖) of the parallel solution,
+ *          the part of the parallel time spent creating processes,
+ *          and the CPUs of the workers (-A policy:cpu/cpu/...)
  *
  * NOTE:
  * Cramer's Rule has very high computational complexity (≈ O(n⁴)).
@@ -24,226 +61,5940 @@
  * not for practical large-scale linear equation solving.
  *****************************************************************************************/
 
+#define _GNU_SOURCE   /* memfd_create, environ */
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <float.h>
 #include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <poll.h>
+#include <sched.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 
 /*****************************************************************************************
  * MATRIX MEMORY MANAGEMENT
  * These helper functions dynamically allocate, copy, and free matrices.
+ *
+ * A matrix lives in one contiguous, 64-byte aligned buffer. Rows are padded to a
+ * leading dimension (ld) that is a multiple of 8 doubles, so every row starts on a
+ * cache-line boundary and a whole matrix costs a single allocation.
+ *
+ * With -N every allocation states who will use it, and the pages get a NUMA
+ * policy through the mbind() system call before anything touches them:
+ *      MEM_SHARED   read by all workers (A, the DAG grids, the prefork region):
+ *                   interleaved over every node with memory
+ *      MEM_LOCAL    one worker's scratch (arena slots): preferred on the node of
+ *                   the CPU that -A pinned the allocating worker to; an unpinned
+ *                   worker can migrate, so its scratch is left to first touch
+ * Such buffers are mapped fresh with mmap() and unmapped on release, never taken
+ * from malloc: a policy covers whole pages, and a recycled heap page may be shared
+ * with unrelated data. Without -N, and for MEM_FIRST_TOUCH, each page lands on the
+ * node of the thread that first writes it. If mbind fails (a kernel without NUMA,
+ * or a sandbox that forbids it) the policies are switched off and everything falls
+ * back to first touch. A single-node machine takes the same code path with a mask
+ * of one node.
  *****************************************************************************************/
 
-/* Dynamically allocate an n × n matrix */
-double **makeGrid(int dim)
+#define GRID_ALIGN 64
+#define GRID_PAD   (GRID_ALIGN / (int)sizeof(double))
+
+typedef struct
+{
+    double *data;   /* Row r starts at data + r * ld */
+    int n;          /* Matrix dimension */
+    int ld;         /* Leading dimension (row stride in doubles) */
+    size_t mapped;  /* Bytes mmap'ed for a NUMA policy, 0 if data came from malloc */
+} Grid;
+
+/* Pointer to the first element of row r */
+#define GRID_ROW(g, r) ((g)->data + (size_t)(r) * (g)->ld)
+
+/* Round a dimension up to a whole number of cache lines */
+static int gridStride(int dim)
+{
+    return (dim + GRID_PAD - 1) / GRID_PAD * GRID_PAD;
+}
+
+#define MEM_FIRST_TOUCH 0
+#define MEM_SHARED      1
+#define MEM_LOCAL       2
+
+#define NUMA_MAX_NODES 63   /* Nodes that fit the one-word node mask */
+
+#ifndef MPOL_PREFERRED      /* <numaif.h> comes with libnuma, which we do not need */
+#define MPOL_PREFERRED  1
+#define MPOL_BIND       2
+#define MPOL_INTERLEAVE 3
+#endif
+
+static int numaPolicies = 0;          /* Set by -N, cleared if the kernel refuses a policy */
+static unsigned long numaMask = 0;    /* Nodes with memory */
+static __thread int localNode = -1;   /* Node of the CPU placeWorker pinned this thread to */
+
+/* Read a sysfs node list such as "0-1,3" into a mask; 0 if it cannot be read */
+static unsigned long nodeListMask(const char *path)
+{
+    unsigned long mask = 0;
+    int lo, hi;
+    char sep;
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+    while (fscanf(f, "%d", &lo) == 1)
+    {
+        hi = lo;
+        if (fscanf(f, "%c", &sep) == 1 && sep == '-')
+        {
+            if (fscanf(f, "%d", &hi) != 1)
+                break;
+            if (fscanf(f, "%c", &sep) != 1)
+                sep = 0;
+        }
+        for (int node = lo; node <= hi && node < NUMA_MAX_NODES; node++)
+            mask |= 1UL << node;
+        if (sep != ',')
+            break;
+    }
+    fclose(f);
+    return mask;
+}
+
+/* Enable the -N policies; returns the number of nodes they spread over */
+int numaInit(void)
+{
+    numaMask = nodeListMask("/sys/devices/system/node/has_memory");
+    if (numaMask == 0)
+        numaMask = 1;   // No sysfs node list: a single node 0
+    numaPolicies = 1;
+    return __builtin_popcountl(numaMask);
+}
+
+/* The CSV's numa_policy for a backend row: how A and the shared buffers were placed */
+static const char *numaLabel(void)
+{
+    return numaPolicies ? "interleave" : "first-touch";
+}
+
+/* NUMA node of the CPU this thread is running on (0 if unknown) */
+static int currentNode(void)
+{
+    unsigned cpu, node;
+    return (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) ? (int)node : 0;
+}
+
+/* Does `role` get a policy? MEM_LOCAL needs a pinned thread to name its node */
+static int memPolicyApplies(int role)
 {
-    double **grid = malloc(dim * sizeof(double *));
-    for (int i = 0; i < dim; i++)
-        grid[i] = malloc(dim * sizeof(double));
+    return numaPolicies && role != MEM_FIRST_TOUCH && (role != MEM_LOCAL || localNode >= 0);
+}
+
+/* Give fresh, untouched pages [addr, addr + bytes) the policy of `role` */
+static void memPolicy(void *addr, size_t bytes, int role)
+{
+    if (!memPolicyApplies(role))
+        return;
+
+    unsigned long mask = numaMask;
+    int mode = MPOL_INTERLEAVE;
+    if (role == MEM_LOCAL)
+    {
+        mask = 1UL << localNode;
+        mode = MPOL_PREFERRED;
+    }
+    /* No MPOL_MF_MOVE: the pages are not faulted in yet, so nothing needs moving */
+    if (syscall(SYS_mbind, addr, bytes, mode, &mask, NUMA_MAX_NODES + 1, 0) < 0)
+    {
+        perror("mbind (NUMA policies off, using first touch)");
+        numaPolicies = 0;
+    }
+}
+
+/* Point grid->data at `bytes` of storage for `role`: 64-byte aligned from malloc,
+   or freshly mapped pages that only this grid uses when a policy applies */
+static void gridAlloc(Grid *grid, size_t bytes, int role)
+{
+    grid->mapped = 0;
+    if (!memPolicyApplies(role))
+    {
+        grid->data = aligned_alloc(GRID_ALIGN, bytes);
+        return;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    bytes = (bytes + page - 1) / page * page;
+    void *pages = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED)
+    {
+        grid->data = NULL;
+        return;
+    }
+    memPolicy(pages, bytes, role);
+    grid->data = pages;
+    grid->mapped = bytes;
+}
+
+/* Release storage from gridAlloc */
+static void gridFree(Grid *grid)
+{
+    if (grid->mapped)
+        munmap(grid->data, grid->mapped);
+    else
+        free(grid->data);
+    grid->data = NULL;
+    grid->mapped = 0;
+}
+
+/* Dynamically allocate an n × n matrix whose pages suit `role` */
+Grid makeGridFor(int dim, int role)
+{
+    Grid grid;
+    grid.n = dim;
+    grid.ld = gridStride(dim > 0 ? dim : 1);
+    gridAlloc(&grid, (size_t)grid.ld * (dim > 0 ? dim : 1) * sizeof(double), role);
+    if (!grid.data)
+    {
+        perror("makeGrid");
+        exit(1);
+    }
     return grid;
 }
 
+/* Dynamically allocate an n × n matrix */
+Grid makeGrid(int dim)
+{
+    return makeGridFor(dim, MEM_FIRST_TOUCH);
+}
+
 /* Free memory allocated to a matrix */
-void destroyGrid(double **grid, int dim)
+void destroyGrid(Grid *grid)
 {
-    for (int i = 0; i < dim; i++)
-        free(grid[i]);
-    free(grid);
+    gridFree(grid);
 }
 
 /* Copy matrix src → dest */
-void cloneGrid(double **src, double **dest, int dim)
+void cloneGrid(const Grid *src, Grid *dest)
 {
-    for (int i = 0; i < dim; i++)
-        for (int j = 0; j < dim; j++)
-            dest[i][j] = src[i][j];
+    if (src->ld == dest->ld)
+    {
+        memcpy(dest->data, src->data, (size_t)src->n * src->ld * sizeof(double));
+        return;
+    }
+    for (int i = 0; i < src->n; i++)
+        memcpy(GRID_ROW(dest, i), GRID_ROW(src, i), src->n * sizeof(double));
 }
 
 /* Replace a column of matrix with vector B (Used in Cramer's Rule) */
-void swapColumn(double **grid, double *vec, int colIndex, int dim)
+void swapColumn(Grid *grid, const double *vec, int colIndex)
 {
-    for (int i = 0; i < dim; i++)
-        grid[i][colIndex] = vec[i];
+    for (int i = 0; i < grid->n; i++)
+        GRID_ROW(grid, i)[colIndex] = vec[i];
 }
 
 /*****************************************************************************************
- * DETERMINANT CALCULATION
- *
- * Uses Gaussian Elimination to convert the matrix into upper triangular form.
- * Determinant = product of diagonal elements.
+ * SCRATCH ARENA
  *
- * Time Complexity: O(n³)
+ * calcDet destroys its input, so every determinant needs a private copy of A.
+ * Instead of one makeGrid/destroyGrid pair per determinant, a solver borrows a
+ * scratch matrix from an arena and reuses it for every calcDet call. Buffers only
+ * grow, so a caller that keeps one arena alive across a size sweep stops hitting
+ * the allocator once the largest size has been seen.
  *****************************************************************************************/
-double calcDet(double **grid, int dim)
+
+#define ARENA_SLOTS 4
+
+typedef struct
 {
-    double result = 1.0;
+    Grid slot[ARENA_SLOTS];       /* Scratch matrices handed out by arenaGrid */
+    size_t cap[ARENA_SLOTS];      /* Allocated capacity of each slot in doubles */
+} ScratchArena;
 
-    for (int i = 0; i < dim; i++)
-    {
-        /* If pivot element is near zero, determinant becomes zero */
-        if (fabs(grid[i][i]) < 1e-9)
-            return 0;
+/* Start with an empty arena (no memory is allocated until first use) */
+void arenaInit(ScratchArena *ar)
+{
+    memset(ar, 0, sizeof(*ar));
+}
+
+/* Return scratch matrix number `slot` resized to dim × dim, reallocating only on growth */
+Grid *arenaGrid(ScratchArena *ar, int slot, int dim)
+{
+    Grid *g = &ar->slot[slot];
+    int ld = gridStride(dim > 0 ? dim : 1);
+    size_t need = (size_t)ld * (dim > 0 ? dim : 1);
 
-        /* Eliminate elements below pivot */
-        for (int j = i + 1; j < dim; j++)
+    if (need > ar->cap[slot])
+    {
+        gridFree(g);
+        gridAlloc(g, need * sizeof(double), MEM_LOCAL);   // Arenas belong to one worker
+        if (!g->data)
         {
-            double factor = grid[j][i] / grid[i][i];
-            for (int k = 0; k < dim; k++)
-                grid[j][k] -= factor * grid[i][k];
+            perror("arenaGrid");
+            exit(1);
         }
-
-        result *= grid[i][i];
+        ar->cap[slot] = need;
     }
-    return result;
+    g->n = dim;
+    g->ld = ld;
+    return g;
+}
+
+/* Free every buffer owned by the arena */
+void arenaRelease(ScratchArena *ar)
+{
+    for (int i = 0; i < ARENA_SLOTS; i++)
+        gridFree(&ar->slot[i]);
+    arenaInit(ar);
 }
 
 /*****************************************************************************************
- * SEQUENTIAL CRAMER SOLVER
+ * WORKER POOLS AND THREAD TEAM
  *
- * Steps:
- * 1. Compute determinant of original matrix A
- * 2. For each variable Xi:
- *      - Replace column i of A with vector B
- *      - Compute determinant of modified matrix
- *      - Xi = det(Ai) / det(A)
+ * Both parallel backends size their pool from -p, falling back to the number of
+ * online CPUs (or LIMIT_PROC when that is unknown).
+ *
+ * ThreadTeam is a persistent fork-join team: teamRun() wakes the size − 1 pool
+ * threads, runs the task on them and on the calling thread (tid 0), and returns
+ * once all of them are done. It serves both the column loop of the thread backend
+ * and the trailing updates inside one determinant. A task already running on the
+ * team never posts a nested one; insideTeam marks such threads.
+ *
+ * With -A every worker is pinned to one CPU: worker w of any backend (team
+ * thread w, DAG thread w, forked or prefork process w) runs on placeCpus[w],
+ * wrapping around. The calling thread is never pinned, even where it takes part
+ * as team member 0, so the sequential baseline runs as it does without -A.
+ * Threads and forked workers pin themselves, so they know their node before they
+ * allocate scratch; exec'd workers are pinned by the parent after the spawn.
+ * The list is built once from the CPUs this process may use, ordered by the
+ * policy from the sysfs topology (package and core of every CPU):
+ *      compact   fill a core's hardware threads, then the next core, then package
+ *      scatter   spread over packages first, then cores, then hardware threads
+ *      physical  one thread on every core first, the SMT siblings after that
+ *      nosmt     one thread per core only; the siblings are left idle
  *****************************************************************************************/
-void linearSolveSeq(double **A, double *B, double *X, int n)
+
+#define LIMIT_PROC 8   /* Pool size when the CPU count is unknown */
+
+static int workerCount = 0;   /* Pool size from -p; 0 means one per online CPU */
+static int detThreads = 1;    /* Threads inside one determinant from -t; 0 means the pool size */
+
+static __thread int insideTeam = 0;   /* Set while this thread runs a team task */
+
+/* Number of workers to use for n independent jobs */
+static int poolSize(int n)
+{
+    int w = workerCount;
+    if (w <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        w = (cpus > 0) ? (int)cpus : LIMIT_PROC;
+    }
+    return (w < n) ? w : n;
+}
+
+#define PLACE_NONE     0
+#define PLACE_COMPACT  1
+#define PLACE_SCATTER  2
+#define PLACE_PHYSICAL 3
+#define PLACE_NOSMT    4
+#define PLACE_MODES    5
+
+static int placeMode = PLACE_NONE;   /* Selected with -A none|compact|scatter|physical|nosmt */
+static const char *placeNames[PLACE_MODES] = { "none", "compact", "scatter", "physical", "nosmt" };
+
+static int *placeCpus = NULL;   /* CPU of worker w is placeCpus[w % placeCount] */
+static int placeCount = 0;      /* 0: workers are not pinned */
+
+typedef struct
 {
-    double **tmp = makeGrid(n);
-    cloneGrid(A, tmp, n);
+    int cpu;
+    int package;   /* physical_package_id */
+    int core;      /* core_id, unique within its package */
+    int sibling;   /* Rank among the usable hardware threads of its core */
+} CpuSlot;
 
-    double detA = calcDet(tmp, n);
-    destroyGrid(tmp, n);
+/* A topology value of one CPU from sysfs, or `fallback` where it cannot be read */
+static int cpuTopology(int cpu, const char *name, int fallback)
+{
+    char path[96];
+    int v = fallback;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    FILE *f = fopen(path, "r");
+    if (f)
+    {
+        if (fscanf(f, "%d", &v) != 1)
+            v = fallback;
+        fclose(f);
+    }
+    return v;
+}
 
-    if (detA == 0) return;  // No unique solution
+/* Placement order of two CPUs under placeMode */
+static int placeCompare(const void *pa, const void *pb)
+{
+    const CpuSlot *a = pa, *b = pb;
+    int ka[3], kb[3];
 
-    for (int i = 0; i < n; i++)
+    if (placeMode == PLACE_COMPACT)
+    {
+        ka[0] = a->package; ka[1] = a->core; ka[2] = a->sibling;
+        kb[0] = b->package; kb[1] = b->core; kb[2] = b->sibling;
+    }
+    else if (placeMode == PLACE_SCATTER)
+    {
+        ka[0] = a->sibling; ka[1] = a->core; ka[2] = a->package;
+        kb[0] = b->sibling; kb[1] = b->core; kb[2] = b->package;
+    }
+    else   // physical and nosmt
     {
-        tmp = makeGrid(n);
-        cloneGrid(A, tmp, n);
+        ka[0] = a->sibling; ka[1] = a->package; ka[2] = a->core;
+        kb[0] = b->sibling; kb[1] = b->package; kb[2] = b->core;
+    }
+    for (int i = 0; i < 3; i++)
+        if (ka[i] != kb[i])
+            return (ka[i] < kb[i]) ? -1 : 1;
+    return a->cpu - b->cpu;
+}
 
-        swapColumn(tmp, B, i, n);
-        X[i] = calcDet(tmp, n) / detA;
+/* Build placeCpus for placeMode from the CPUs in our affinity mask */
+void placementInit(void)
+{
+    cpu_set_t allowed;
+    if (placeMode == PLACE_NONE || sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+        return;
 
-        destroyGrid(tmp, n);
+    CpuSlot *slots = malloc(CPU_SETSIZE * sizeof(CpuSlot));
+    int count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+        slots[count].cpu = cpu;
+        slots[count].package = cpuTopology(cpu, "physical_package_id", 0);
+        slots[count].core = cpuTopology(cpu, "core_id", cpu);   // No topology: every CPU a core
+        slots[count].sibling = 0;
+        for (int j = 0; j < count; j++)
+            if (slots[j].package == slots[count].package && slots[j].core == slots[count].core)
+                slots[count].sibling++;
+        count++;
     }
+    qsort(slots, count, sizeof(CpuSlot), placeCompare);
+
+    placeCpus = malloc((count ? count : 1) * sizeof(int));
+    placeCount = 0;
+    for (int i = 0; i < count; i++)
+        if (placeMode != PLACE_NOSMT || slots[i].sibling == 0)
+            placeCpus[placeCount++] = slots[i].cpu;
+    free(slots);
 }
 
-/*****************************************************************************************
- * PARALLEL CRAMER SOLVER (PROCESS-BASED PARALLELISM)
- *
- * fork() creates child processes.
- * Each child computes one variable Xi independently.
- *
- * Important Concept:
- * fork() creates separate memory spaces, so this demonstrates
- * process-level parallelism rather than shared-memory parallelism.
- *****************************************************************************************/
-void linearSolvePar(double **A, double *B, double *X, int n)
+/* Pin a process, or the calling thread for pid 0, to the CPU of worker w. A thread
+   that pins itself records the node of that CPU for its MEM_LOCAL allocations. */
+static void placeWorker(pid_t pid, int w)
 {
-    double **tmp = makeGrid(n);
-    cloneGrid(A, tmp, n);
-    double detA = calcDet(tmp, n);
-    destroyGrid(tmp, n);
+    if (placeCount == 0)
+        return;
 
-    if (detA == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(placeCpus[w % placeCount], &set);
+    if (sched_setaffinity(pid, sizeof(set), &set) < 0)
+        perror("sched_setaffinity");
+    else if (pid == 0)
+        localNode = currentNode();   // The kernel has moved us onto the CPU by now
+}
 
-    for (int i = 0; i < n; i++)
+/* "policy:cpu/cpu/..." for the first `workers` workers (the CSV's placement) */
+static void placeDescribe(char *buf, size_t size, int workers)
+{
+    int len = snprintf(buf, size, "%s", placeNames[placeMode]);
+    for (int w = 0; w < workers && placeCount > 0 && len < (int)size; w++)
+        len += snprintf(buf + len, size - len, "%c%d", w ? '/' : ':', placeCpus[w % placeCount]);
+}
+
+typedef void (*TeamTask)(void *arg, int tid, int nthreads);
+
+typedef struct
+{
+    int size;                  /* Threads in the team, including the caller */
+    pthread_t *threads;        /* size − 1 pool threads */
+    ScratchArena *arenas;      /* One scratch arena per thread */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;       /* Signalled when a new task is posted */
+    pthread_cond_t idle;       /* Signalled when the last pool thread finishes */
+    TeamTask task;
+    void *arg;
+    unsigned generation;       /* Bumped for every posted task */
+    int running;               /* Pool threads still working on the current task */
+    int quit;
+} ThreadTeam;
+
+typedef struct
+{
+    ThreadTeam *team;
+    int tid;
+} TeamSeat;
+
+static void *teamThread(void *p)
+{
+    TeamSeat *seat = p;
+    ThreadTeam *t = seat->team;
+    int tid = seat->tid;
+    unsigned seen = 0;
+    free(seat);
+    insideTeam = 1;
+    placeWorker(0, tid);
+
+    pthread_mutex_lock(&t->lock);
+    for (;;)
     {
-        if (fork() == 0)   // Child process
-        {
-            double **local = makeGrid(n);
-            cloneGrid(A, local, n);
+        while (!t->quit && t->generation == seen)
+            pthread_cond_wait(&t->wake, &t->lock);
+        if (t->quit)
+            break;
+        seen = t->generation;
+
+        pthread_mutex_unlock(&t->lock);
+        t->task(t->arg, tid, t->size);
+        pthread_mutex_lock(&t->lock);
+
+        if (--t->running == 0)
+            pthread_cond_signal(&t->idle);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
 
-            swapColumn(local, B, i, n);
-            X[i] = calcDet(local, n) / detA;
+/* Start a team of `size` threads (the caller counts as one of them) */
+void teamStart(ThreadTeam *t, int size)
+{
+    memset(t, 0, sizeof(*t));
+    t->size = size > 0 ? size : 1;
+    t->threads = calloc(t->size, sizeof(pthread_t));
+    t->arenas = calloc(t->size, sizeof(ScratchArena));
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->wake, NULL);
+    pthread_cond_init(&t->idle, NULL);
 
-            destroyGrid(local, n);
-            exit(0);  // Child exits after its computation
+    for (int i = 1; i < t->size; i++)
+    {
+        TeamSeat *seat = malloc(sizeof(*seat));
+        seat->team = t;
+        seat->tid = i;
+        if (pthread_create(&t->threads[i], NULL, teamThread, seat) != 0)
+        {
+            perror("pthread_create");
+            free(seat);
+            t->size = i;   // Run with the threads we have
+            break;
         }
     }
+}
 
-    /* Parent waits for all children to finish */
-    for (int i = 0; i < n; i++)
-        wait(NULL);
+/* Run task(arg, tid, size) on every team member and wait for all of them */
+void teamRun(ThreadTeam *t, TeamTask task, void *arg)
+{
+    pthread_mutex_lock(&t->lock);
+    t->task = task;
+    t->arg = arg;
+    t->running = t->size - 1;
+    t->generation++;
+    pthread_cond_broadcast(&t->wake);
+    pthread_mutex_unlock(&t->lock);
+
+    int wasInside = insideTeam;
+    insideTeam = 1;
+    task(arg, 0, t->size);
+    insideTeam = wasInside;
+
+    pthread_mutex_lock(&t->lock);
+    while (t->running > 0)
+        pthread_cond_wait(&t->idle, &t->lock);
+    pthread_mutex_unlock(&t->lock);
+}
+
+/* Join the pool threads and free the per-thread arenas */
+void teamStop(ThreadTeam *t)
+{
+    pthread_mutex_lock(&t->lock);
+    t->quit = 1;
+    pthread_cond_broadcast(&t->wake);
+    pthread_mutex_unlock(&t->lock);
+
+    for (int i = 1; i < t->size; i++)
+        pthread_join(t->threads[i], NULL);
+    for (int i = 0; i < t->size; i++)
+        arenaRelease(&t->arenas[i]);
+
+    free(t->threads);
+    free(t->arenas);
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->wake);
+    pthread_cond_destroy(&t->idle);
+}
+
+static ThreadTeam team;
+static int teamReady = 0;
+
+/* The shared team, started on first use with the larger of the -p and -t sizes */
+static ThreadTeam *sharedTeam(void)
+{
+    if (!teamReady)
+    {
+        int size = poolSize(1 << 30);
+        teamStart(&team, (detThreads > size) ? detThreads : size);
+        teamReady = 1;
+    }
+    return &team;
 }
 
 /*****************************************************************************************
- * MAIN FUNCTION — PERFORMANCE DRIVER
+ * SIMD KERNELS
  *
- * Accepts multiple matrix sizes from command line,
- * runs both sequential and parallel solvers,
- * measures execution time, and writes results to CSV.
+ * All floating-point work of the elimination goes through two kernels:
+ *      axpy : y[0..w) -= f · x[0..w)                 (row update)
+ *      gemm : C[m×w] -= A[m×k] · B[k×w]               (trailing-matrix update)
+ * plus one for batches of small systems (see linearSolveBatch):
+ *      batch: solve batchLanes interleaved n × n systems at once
+ * and float copies of axpy and gemm (axpyf, gemmf) for the mixed-precision LU.
+ *
+ * Each kernel exists in a portable C version and, on x86, in SSE2, AVX2+FMA and
+ * AVX-512 versions. selectKernels() picks the widest set the CPU supports (CPUID via
+ * __builtin_cpu_supports) once at startup, so one binary runs well on every host.
+ * The gemm kernels keep an MR × NR block of C in registers for the whole k loop.
  *****************************************************************************************/
-int main(int argc, char *argv[])
+
+#define GEMM_COL_CHUNK 256   /* Columns of the trailing matrix updated per pass */
+
+typedef void (*AxpyKernel)(double *y, const double *x, double f, int w);
+typedef void (*GemmKernel)(double *C, int ldc, const double *A, int lda,
+                           const double *B, int ldb, int m, int w, int k);
+typedef void (*BatchKernel)(double *A, double *B, double *X, double *det, int n);
+typedef void (*AxpyFloatKernel)(float *y, const float *x, float f, int w);
+typedef void (*GemmFloatKernel)(float *C, int ldc, const float *A, int lda,
+                                const float *B, int ldb, int m, int w, int k);
+
+typedef struct
+{
+    const char *name;
+    AxpyKernel axpy;
+    GemmKernel gemm;
+    BatchKernel batch;
+    int batchLanes;          /* Systems per vector in batch: one register of doubles */
+    AxpyFloatKernel axpyf;
+    GemmFloatKernel gemmf;
+} KernelSet;
+
+/* Portable fallbacks */
+static void axpyScalar(double *y, const double *x, double f, int w)
 {
-    if (argc < 2)
+    for (int c = 0; c < w; c++)
+        y[c] -= f * x[c];
+}
+
+static void gemmScalar(double *C, int ldc, const double *A, int lda,
+                       const double *B, int ldb, int m, int w, int k)
+{
+    /* Walk C in column chunks so the k × chunk slice of B stays cache resident */
+    for (int c0 = 0; c0 < w; c0 += GEMM_COL_CHUNK)
     {
-        printf("Usage: %s size1 size2 size3 ...\n", argv[0]);
-        return 1;
+        int cw = (w - c0 < GEMM_COL_CHUNK) ? w - c0 : GEMM_COL_CHUNK;
+        for (int i = 0; i < m; i++)
+            for (int p = 0; p < k; p++)
+                axpyScalar(C + (size_t)i * ldc + c0, B + (size_t)p * ldb + c0,
+                           A[(size_t)i * lda + p], cw);
     }
+}
 
-    /* Open CSV file in current working directory */
-    FILE *fp = fopen("results.csv", "w");
-    if (!fp)
+/* Leftover columns of an MR-row block, done as plain dot products */
+static void gemmEdgeColumns(double *C, int ldc, const double *A, int lda,
+                            const double *B, int ldb, int rows, int c, int cEnd, int k)
+{
+    for (int r = 0; r < rows; r++)
+        for (int j = c; j < cEnd; j++)
+        {
+            double sum = 0;
+            for (int p = 0; p < k; p++)
+                sum += A[(size_t)r * lda + p] * B[(size_t)p * ldb + j];
+            C[(size_t)r * ldc + j] -= sum;
+        }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* SSE2: 4 × 4 register block (two xmm per row) */
+__attribute__((target("sse2")))
+static void axpySSE2(double *y, const double *x, double f, int w)
+{
+    __m128d vf = _mm_set1_pd(f);
+    int c = 0;
+    for (; c + 4 <= w; c += 4)
     {
-        perror("Error opening results.csv");
-        return 1;
+        _mm_storeu_pd(y + c, _mm_sub_pd(_mm_loadu_pd(y + c), _mm_mul_pd(vf, _mm_loadu_pd(x + c))));
+        _mm_storeu_pd(y + c + 2, _mm_sub_pd(_mm_loadu_pd(y + c + 2), _mm_mul_pd(vf, _mm_loadu_pd(x + c + 2))));
     }
+    for (; c < w; c++)
+        y[c] -= f * x[c];
+}
 
-    fprintf(fp, "size,seq_time,par_time,speedup\n");
-    fflush(fp);  // Flush header before any fork occurs
+__attribute__((target("sse2")))
+static void gemmSSE2(double *C, int ldc, const double *A, int lda,
+                     const double *B, int ldb, int m, int w, int k)
+{
+    for (int c0 = 0; c0 < w; c0 += GEMM_COL_CHUNK)
+    {
+        int cEnd = (w - c0 < GEMM_COL_CHUNK) ? w : c0 + GEMM_COL_CHUNK;
+        int i = 0;
+        for (; i + 4 <= m; i += 4)
+        {
+            const double *a = A + (size_t)i * lda;
+            double *cb = C + (size_t)i * ldc;
+            int c = c0;
+            for (; c + 4 <= cEnd; c += 4)
+            {
+                __m128d acc[4][2];
+                for (int r = 0; r < 4; r++)
+                    acc[r][0] = acc[r][1] = _mm_setzero_pd();
+                for (int p = 0; p < k; p++)
+                {
+                    __m128d b0 = _mm_loadu_pd(B + (size_t)p * ldb + c);
+                    __m128d b1 = _mm_loadu_pd(B + (size_t)p * ldb + c + 2);
+                    for (int r = 0; r < 4; r++)
+                    {
+                        __m128d av = _mm_set1_pd(a[(size_t)r * lda + p]);
+                        acc[r][0] = _mm_add_pd(acc[r][0], _mm_mul_pd(av, b0));
+                        acc[r][1] = _mm_add_pd(acc[r][1], _mm_mul_pd(av, b1));
+                    }
+                }
+                for (int r = 0; r < 4; r++)
+                {
+                    double *cr = cb + (size_t)r * ldc + c;
+                    _mm_storeu_pd(cr, _mm_sub_pd(_mm_loadu_pd(cr), acc[r][0]));
+                    _mm_storeu_pd(cr + 2, _mm_sub_pd(_mm_loadu_pd(cr + 2), acc[r][1]));
+                }
+            }
+            gemmEdgeColumns(cb, ldc, a, lda, B, ldb, 4, c, cEnd, k);
+        }
+        for (; i < m; i++)
+            for (int p = 0; p < k; p++)
+                axpySSE2(C + (size_t)i * ldc + c0, B + (size_t)p * ldb + c0,
+                         A[(size_t)i * lda + p], cEnd - c0);
+    }
+}
 
-    srand(time(NULL));  // Seed random generator
+/* AVX2 + FMA: 4 × 8 register block (two ymm per row) */
+__attribute__((target("avx2,fma")))
+static void axpyAVX2(double *y, const double *x, double f, int w)
+{
+    __m256d vf = _mm256_set1_pd(f);
+    int c = 0;
+    for (; c + 8 <= w; c += 8)
+    {
+        _mm256_storeu_pd(y + c, _mm256_fnmadd_pd(vf, _mm256_loadu_pd(x + c), _mm256_loadu_pd(y + c)));
+        _mm256_storeu_pd(y + c + 4, _mm256_fnmadd_pd(vf, _mm256_loadu_pd(x + c + 4), _mm256_loadu_pd(y + c + 4)));
+    }
+    for (; c + 4 <= w; c += 4)
+        _mm256_storeu_pd(y + c, _mm256_fnmadd_pd(vf, _mm256_loadu_pd(x + c), _mm256_loadu_pd(y + c)));
+    for (; c < w; c++)
+        y[c] -= f * x[c];
+}
 
-    for (int arg = 1; arg < argc; arg++)
+__attribute__((target("avx2,fma")))
+static void gemmAVX2(double *C, int ldc, const double *A, int lda,
+                     const double *B, int ldb, int m, int w, int k)
+{
+    for (int c0 = 0; c0 < w; c0 += GEMM_COL_CHUNK)
     {
-        int n = atoi(argv[arg]);
-        printf("\nRunning for matrix size %d\n", n);
+        int cEnd = (w - c0 < GEMM_COL_CHUNK) ? w : c0 + GEMM_COL_CHUNK;
+        int i = 0;
+        for (; i + 4 <= m; i += 4)
+        {
+            const double *a = A + (size_t)i * lda;
+            double *cb = C + (size_t)i * ldc;
+            int c = c0;
+            for (; c + 8 <= cEnd; c += 8)
+            {
+                __m256d acc[4][2];
+                for (int r = 0; r < 4; r++)
+                    acc[r][0] = acc[r][1] = _mm256_setzero_pd();
+                for (int p = 0; p < k; p++)
+                {
+                    __m256d b0 = _mm256_loadu_pd(B + (size_t)p * ldb + c);
+                    __m256d b1 = _mm256_loadu_pd(B + (size_t)p * ldb + c + 4);
+                    for (int r = 0; r < 4; r++)
+                    {
+                        __m256d av = _mm256_broadcast_sd(a + (size_t)r * lda + p);
+                        acc[r][0] = _mm256_fmadd_pd(av, b0, acc[r][0]);
+                        acc[r][1] = _mm256_fmadd_pd(av, b1, acc[r][1]);
+                    }
+                }
+                for (int r = 0; r < 4; r++)
+                {
+                    double *cr = cb + (size_t)r * ldc + c;
+                    _mm256_storeu_pd(cr, _mm256_sub_pd(_mm256_loadu_pd(cr), acc[r][0]));
+                    _mm256_storeu_pd(cr + 4, _mm256_sub_pd(_mm256_loadu_pd(cr + 4), acc[r][1]));
+                }
+            }
+            gemmEdgeColumns(cb, ldc, a, lda, B, ldb, 4, c, cEnd, k);
+        }
+        for (; i < m; i++)
+            for (int p = 0; p < k; p++)
+                axpyAVX2(C + (size_t)i * ldc + c0, B + (size_t)p * ldb + c0,
+                         A[(size_t)i * lda + p], cEnd - c0);
+    }
+}
 
-        /* Allocate matrix and vectors */
-        double **A = makeGrid(n);
-        double *B = malloc(n * sizeof(double));
-        double *X = malloc(n * sizeof(double));
+/* AVX-512: 4 × 16 register block (two zmm per row) */
+__attribute__((target("avx512f")))
+static void axpyAVX512(double *y, const double *x, double f, int w)
+{
+    __m512d vf = _mm512_set1_pd(f);
+    int c = 0;
+    for (; c + 8 <= w; c += 8)
+        _mm512_storeu_pd(y + c, _mm512_fnmadd_pd(vf, _mm512_loadu_pd(x + c), _mm512_loadu_pd(y + c)));
+    if (c < w)
+    {
+        __mmask8 tail = (__mmask8)((1u << (w - c)) - 1);
+        __m512d yv = _mm512_maskz_loadu_pd(tail, y + c);
+        __m512d xv = _mm512_maskz_loadu_pd(tail, x + c);
+        _mm512_mask_storeu_pd(y + c, tail, _mm512_fnmadd_pd(vf, xv, yv));
+    }
+}
 
-        /* Fill matrix with random values */
-        for (int i = 0; i < n; i++)
+__attribute__((target("avx512f")))
+static void gemmAVX512(double *C, int ldc, const double *A, int lda,
+                       const double *B, int ldb, int m, int w, int k)
+{
+    for (int c0 = 0; c0 < w; c0 += GEMM_COL_CHUNK)
+    {
+        int cEnd = (w - c0 < GEMM_COL_CHUNK) ? w : c0 + GEMM_COL_CHUNK;
+        int i = 0;
+        for (; i + 4 <= m; i += 4)
         {
-            B[i] = rand() % 10;
-            for (int j = 0; j < n; j++)
-                A[i][j] = rand() % 10;
+            const double *a = A + (size_t)i * lda;
+            double *cb = C + (size_t)i * ldc;
+            int c = c0;
+            for (; c + 16 <= cEnd; c += 16)
+            {
+                __m512d acc[4][2];
+                for (int r = 0; r < 4; r++)
+                    acc[r][0] = acc[r][1] = _mm512_setzero_pd();
+                for (int p = 0; p < k; p++)
+                {
+                    __m512d b0 = _mm512_loadu_pd(B + (size_t)p * ldb + c);
+                    __m512d b1 = _mm512_loadu_pd(B + (size_t)p * ldb + c + 8);
+                    for (int r = 0; r < 4; r++)
+                    {
+                        __m512d av = _mm512_set1_pd(a[(size_t)r * lda + p]);
+                        acc[r][0] = _mm512_fmadd_pd(av, b0, acc[r][0]);
+                        acc[r][1] = _mm512_fmadd_pd(av, b1, acc[r][1]);
+                    }
+                }
+                for (int r = 0; r < 4; r++)
+                {
+                    double *cr = cb + (size_t)r * ldc + c;
+                    _mm512_storeu_pd(cr, _mm512_sub_pd(_mm512_loadu_pd(cr), acc[r][0]));
+                    _mm512_storeu_pd(cr + 8, _mm512_sub_pd(_mm512_loadu_pd(cr + 8), acc[r][1]));
+                }
+            }
+            gemmEdgeColumns(cb, ldc, a, lda, B, ldb, 4, c, cEnd, k);
         }
+        for (; i < m; i++)
+            for (int p = 0; p < k; p++)
+                axpyAVX512(C + (size_t)i * ldc + c0, B + (size_t)p * ldb + c0,
+                           A[(size_t)i * lda + p], cEnd - c0);
+    }
+}
+#endif
 
-        /* Sequential timing */
-        clock_t t1 = clock();
-        linearSolveSeq(A, B, X, n);
-        clock_t t2 = clock();
-        double seqTime = (double)(t2 - t1) / CLOCKS_PER_SEC;
+/*
+ * Batched small systems: W systems are interleaved so that entry (i, j) of all of
+ * them forms one W-wide vector, and every step of the elimination runs on all
+ * lanes at once. W is the register width of the kernel set (batchLanes: 8 for
+ * AVX-512, 4 for AVX2, 2 for SSE2 and the portable version), so every vector
+ * operation is one instruction and the loop keeps its vectors in registers. The
+ * body is written once with GCC vector extensions and stamped out per width.
+ * Lanes pick their pivots independently; the row exchange is a blend, one pass
+ * per distinct pivot row that moves only the lanes which chose it.
+ *
+ * The elimination is blocked by BATCH_PANEL columns: a panel is factored on its
+ * own columns and b, its pivot rows catch up on the columns to the right, and the
+ * trailing rows then take one rank-BATCH_PANEL update each. A group of 64 × 64
+ * systems is 256 KB at 8 lanes, so rank-1 sweeps would stream it from L2 once per
+ * column.
+ *
+ * A lane is singular when its largest candidate pivot is below BATCH_PIVOT_MIN
+ * times the largest entry of its matrix, so scaling a system does not change the
+ * verdict. For entries of order 1 (the driver's rand() % 10 systems) that is the
+ * 1e-9 of luFactor, so batched and one-at-a-time solves agree on them.
+ */
+#define BATCH_LANES_MAX 8       /* Widest lane count of any kernel set */
+#define BATCH_PIVOT_MIN 1e-9    /* Relative pivot cut-off, see above */
+#define BATCH_PANEL     8       /* Columns eliminated per sweep of the trailing rows */
 
-        fflush(fp);  // Flush before fork to avoid duplicate buffer writes
+/* Macros rather than functions: passing vectors by value has no fixed ABI across
+   targets. Vec and Mask are the vector types of the enclosing batch body. */
+#define batchSelect(m, x, y) ((Vec)(((Mask)(x) & (m)) | ((Mask)(y) & ~(m))))
+#define batchAbs(v)          ((Vec)((Mask)(v) & 0x7fffffffffffffffLL))
+
+#define DEFINE_BATCH_BODY(W)                                                            \
+    typedef double BatchVec##W __attribute__((vector_size((W) * sizeof(double))));      \
+    typedef long long BatchMask##W                                                      \
+        __attribute__((vector_size((W) * sizeof(long long))));                          \
+                                                                                        \
+    /* Pivot for column k, per lane: swap the lane's best row into row k (entries from  \
+       column `from` on, and b), then 1 / pivot into *inv. A lane whose best is not     \
+       above tol is finished; it gets pivot 1 and stays finite. */                      \
+    static inline __attribute__((always_inline))                                        \
+    void batchPivot##W(BatchVec##W *a, BatchVec##W *b, BatchVec##W *det,                \
+                       BatchMask##W *singular, const BatchVec##W *tol, int n, int k,    \
+                       int from, BatchVec##W *inv)                                      \
+    {                                                                                   \
+        typedef BatchVec##W Vec;                                                        \
+        typedef BatchMask##W Mask;                                                      \
+        Vec *pivotRow = a + (size_t)k * n, one = (Vec){ 0 } + 1.0;                      \
+        Vec best = batchAbs(pivotRow[k]);                                               \
+        Mask piv = (Mask){ 0 } + k;                                                     \
+        for (int r = k + 1; r < n; r++)                                                 \
+        {                                                                               \
+            Vec v = batchAbs(a[(size_t)r * n + k]);                                     \
+            Mask gt = v > best;                                                         \
+            best = batchSelect(gt, v, best);                                            \
+            piv = (piv & ~gt) | (((Mask){ 0 } + r) & gt);                               \
+        }                                                                               \
+        /* Exchange rows per lane with blends: one pass per distinct pivot row, each    \
+           touching only the lanes that chose it */                                     \
+        Mask todo = piv != k;                                                           \
+        for (int l = 0; l < (W); l++)                                                   \
+        {                                                                               \
+            if (!todo[l])                                                               \
+                continue;                                                               \
+            int r = (int)piv[l];                                                        \
+            Mask m = piv == r;                                                          \
+            Vec *other = a + (size_t)r * n;                                             \
+            for (int j = from; j < n; j++)                                              \
+            {                                                                           \
+                Vec p = pivotRow[j], q = other[j];                                      \
+                pivotRow[j] = batchSelect(m, q, p);                                     \
+                other[j] = batchSelect(m, p, q);                                        \
+            }                                                                           \
+            Vec p = b[k], q = b[r];                                                     \
+            b[k] = batchSelect(m, q, p);                                                \
+            b[r] = batchSelect(m, p, q);                                                \
+            *det = batchSelect(m, -*det, *det);                                         \
+            todo &= ~m;                                                                 \
+        }                                                                               \
+                                                                                        \
+        Mask small = ~(best > *tol);                                                    \
+        *singular |= small;                                                             \
+        Vec pivot = batchSelect(small, one, pivotRow[k]);                               \
+        pivotRow[k] = pivot;                                                            \
+        *det *= pivot;                                                                  \
+        *inv = one / pivot;                                                             \
+    }                                                                                   \
+                                                                                        \
+    /* row[j] −= Σ_t row[k0 + t] · u[t][j] for j ≥ k0 + nb: one rank-nb update with     \
+       the nb multipliers held in registers (nb is a constant at the hot call) */       \
+    static inline __attribute__((always_inline))                                        \
+    void batchRankUpdate##W(BatchVec##W *row, const BatchVec##W *u, int n, int k0,      \
+                            const int nb)                                               \
+    {                                                                                   \
+        typedef BatchVec##W Vec;                                                        \
+        Vec f[BATCH_PANEL] = { 0 };                                                     \
+        _Pragma("GCC unroll 8")                                                         \
+        for (int t = 0; t < nb; t++)                                                    \
+            f[t] = row[k0 + t];                                                         \
+        for (int j = k0 + nb; j < n; j++)                                               \
+        {                                                                               \
+            Vec acc = row[j];                                                           \
+            _Pragma("GCC unroll 8")                                                     \
+            for (int t = 0; t < nb; t++)                                                \
+                acc -= f[t] * u[(size_t)t * n + j];                                     \
+            row[j] = acc;                                                               \
+        }                                                                               \
+    }                                                                                   \
+                                                                                        \
+    static inline __attribute__((always_inline))                                        \
+    void batchSolveBody##W(double *Ap, double *Bp, double *Xp, double *detp, int n)     \
+    {                                                                                   \
+        typedef BatchVec##W Vec;                                                        \
+        typedef BatchMask##W Mask;                                                      \
+        Vec *a = (Vec *)Ap, *b = (Vec *)Bp, *x = (Vec *)Xp;                             \
+        Vec zero = (Vec){ 0 }, det = zero + 1.0, scale = zero, tol, inv;                \
+        Mask singular = (Mask){ 0 };                                                    \
+                                                                                        \
+        /* Largest entry of every lane: the pivot cut-off is relative to it */          \
+        for (size_t e = 0; e < (size_t)n * n; e++)                                      \
+        {                                                                               \
+            Vec v = batchAbs(a[e]);                                                     \
+            scale = batchSelect(v > scale, v, scale);                                   \
+        }                                                                               \
+        tol = scale * BATCH_PIVOT_MIN;                                                  \
+                                                                                        \
+        for (int k0 = 0; k0 < n; k0 += BATCH_PANEL)                                     \
+        {                                                                               \
+            int nb = (n - k0 < BATCH_PANEL) ? n - k0 : BATCH_PANEL, k1 = k0 + nb;       \
+                                                                                        \
+            /* Panel: columns k0..k1 − 1 on the panel and b only; the multipliers stay  \
+               below the diagonal. A row exchange moves the whole row from k0 on. */    \
+            for (int k = k0; k < k1; k++)                                               \
+            {                                                                           \
+                Vec *pivotRow = a + (size_t)k * n;                                      \
+                batchPivot##W(a, b, &det, &singular, &tol, n, k, k0, &inv);             \
+                for (int i = k + 1; i < n; i++)                                         \
+                {                                                                       \
+                    Vec *row = a + (size_t)i * n;                                       \
+                    Vec f = row[k] * inv;                                               \
+                    row[k] = f;                                                         \
+                    for (int j = k + 1; j < k1; j++)                                    \
+                        row[j] -= f * pivotRow[j];                                      \
+                    b[i] -= f * b[k];                                                   \
+                }                                                                       \
+            }                                                                           \
+            if (k1 == n)                                                                \
+                break;                                                                  \
+                                                                                        \
+            /* Block row: the panel's pivot rows catch up on the panel's steps */       \
+            for (int t = k0 + 1; t < k1; t++)                                           \
+            {                                                                           \
+                Vec *row = a + (size_t)t * n;                                           \
+                for (int s = k0; s < t; s++)                                            \
+                    for (int j = k1; j < n; j++)                                        \
+                        row[j] -= row[s] * a[(size_t)s * n + j];                        \
+            }                                                                           \
+                                                                                        \
+            /* Trailing rows: one rank-nb update each instead of nb rank-1 sweeps */    \
+            const Vec *u = a + (size_t)k0 * n;                                          \
+            for (int i = k1; i < n; i++)                                                \
+            {                                                                           \
+                if (nb == BATCH_PANEL)                                                  \
+                    batchRankUpdate##W(a + (size_t)i * n, u, n, k0, BATCH_PANEL);       \
+                else                                                                    \
+                    batchRankUpdate##W(a + (size_t)i * n, u, n, k0, nb);                \
+            }                                                                           \
+        }                                                                               \
+                                                                                        \
+        for (int i = n - 1; i >= 0; i--)                                                \
+        {                                                                               \
+            const Vec *row = a + (size_t)i * n;                                         \
+            Vec s = b[i];                                                               \
+            for (int j = i + 1; j < n; j++)                                             \
+                s -= row[j] * x[j];                                                     \
+            x[i] = batchSelect(singular, zero, s / row[i]);                             \
+        }                                                                               \
+        *(Vec *)detp = batchSelect(singular, zero, det);                                \
+    }
+
+DEFINE_BATCH_BODY(2)
+DEFINE_BATCH_BODY(4)
+DEFINE_BATCH_BODY(8)
+
+static void batchScalar(double *A, double *B, double *X, double *det, int n)
+{
+    batchSolveBody2(A, B, X, det, n);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+static void batchSSE2(double *A, double *B, double *X, double *det, int n)
+{
+    batchSolveBody2(A, B, X, det, n);
+}
+
+__attribute__((target("avx2,fma")))
+static void batchAVX2(double *A, double *B, double *X, double *det, int n)
+{
+    batchSolveBody4(A, B, X, det, n);
+}
+
+__attribute__((target("avx512f")))
+static void batchAVX512(double *A, double *B, double *X, double *det, int n)
+{
+    batchSolveBody8(A, B, X, det, n);
+}
+#endif
+
+/*
+ * Single-precision axpy and gemm for the mixed-precision solver: twice the lanes
+ * per register and half the bytes per row of the double kernels. Like the batch
+ * kernel they are written once with vector extensions (16 floats, unaligned) and
+ * built per instruction set; the gemm is the column-chunked axpy loop of gemmScalar.
+ */
+typedef float FloatVec __attribute__((vector_size(16 * sizeof(float)), aligned(sizeof(float))));
+
+static inline __attribute__((always_inline))
+void axpyFloatBody(float *y, const float *x, float f, int w)
+{
+    int c = 0;
+    for (; c + 32 <= w; c += 32)
+    {
+        FloatVec *yv = (FloatVec *)(y + c);
+        const FloatVec *xv = (const FloatVec *)(x + c);
+        yv[0] -= f * xv[0];
+        yv[1] -= f * xv[1];
+    }
+    for (; c + 16 <= w; c += 16)
+        *(FloatVec *)(y + c) -= f * *(const FloatVec *)(x + c);
+    for (; c < w; c++)
+        y[c] -= f * x[c];
+}
+
+static inline __attribute__((always_inline))
+void gemmFloatBody(float *C, int ldc, const float *A, int lda,
+                   const float *B, int ldb, int m, int w, int k)
+{
+    /* Twice the columns of the double kernel for the same bytes per chunk */
+    for (int c0 = 0; c0 < w; c0 += 2 * GEMM_COL_CHUNK)
+    {
+        int cw = (w - c0 < 2 * GEMM_COL_CHUNK) ? w - c0 : 2 * GEMM_COL_CHUNK;
+        for (int i = 0; i < m; i++)
+            for (int p = 0; p < k; p++)
+                axpyFloatBody(C + (size_t)i * ldc + c0, B + (size_t)p * ldb + c0,
+                              A[(size_t)i * lda + p], cw);
+    }
+}
 
-        /* Parallel timing */
-        t1 = clock();
-        linearSolvePar(A, B, X, n);
-        t2 = clock();
-        double parTime = (double)(t2 - t1) / CLOCKS_PER_SEC;
+#define DEFINE_FLOAT_KERNELS(suffix, isa)                                              \
+    isa static void axpyFloat##suffix(float *y, const float *x, float f, int w)        \
+    {                                                                                  \
+        axpyFloatBody(y, x, f, w);                                                     \
+    }                                                                                  \
+    isa static void gemmFloat##suffix(float *C, int ldc, const float *A, int lda,      \
+                                      const float *B, int ldb, int m, int w, int k)    \
+    {                                                                                  \
+        gemmFloatBody(C, ldc, A, lda, B, ldb, m, w, k);                                \
+    }
+
+DEFINE_FLOAT_KERNELS(Scalar, )
+#if defined(__x86_64__) || defined(__i386__)
+DEFINE_FLOAT_KERNELS(SSE2, __attribute__((target("sse2"))))
+DEFINE_FLOAT_KERNELS(AVX2, __attribute__((target("avx2,fma"))))
+DEFINE_FLOAT_KERNELS(AVX512, __attribute__((target("avx512f"))))
+#endif
 
-        double speedup = (parTime > 0) ? seqTime / parTime : 0;
+static KernelSet kern = { "scalar", axpyScalar, gemmScalar, batchScalar, 2, axpyFloatScalar, gemmFloatScalar };
+
+/* Choose the kernel set: `want` forces one by name, NULL picks the best the CPU supports */
+void selectKernels(const char *want)
+{
+    KernelSet sets[4];
+    int count = 0;
 
-        printf("Seq: %.3f sec | Par: %.3f sec | Speedup: %.2f\n",
-               seqTime, parTime, speedup);
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        sets[count++] = (KernelSet){ "avx512", axpyAVX512, gemmAVX512, batchAVX512, 8,
+                                     axpyFloatAVX512, gemmFloatAVX512 };
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        sets[count++] = (KernelSet){ "avx2", axpyAVX2, gemmAVX2, batchAVX2, 4,
+                                     axpyFloatAVX2, gemmFloatAVX2 };
+    if (__builtin_cpu_supports("sse2"))
+        sets[count++] = (KernelSet){ "sse2", axpySSE2, gemmSSE2, batchSSE2, 2,
+                                     axpyFloatSSE2, gemmFloatSSE2 };
+#endif
+    sets[count++] = (KernelSet){ "scalar", axpyScalar, gemmScalar, batchScalar, 2,
+                                 axpyFloatScalar, gemmFloatScalar };
 
-        fprintf(fp, "%d,%.5f,%.5f,%.2f\n",
-                n, seqTime, parTime, speedup);
-        fflush(fp);  // Ensure data is written safely
+    kern = sets[0];
+    if (want)
+    {
+        for (int i = 0; i < count; i++)
+            if (strcmp(sets[i].name, want) == 0)
+                kern = sets[i];
+        if (strcmp(kern.name, want) != 0)
+            fprintf(stderr, "Kernel '%s' not supported here, using %s\n", want, kern.name);
+    }
+}
+
+/*****************************************************************************************
+ * DETERMINANT CALCULATION
+ *
+ * Uses Gaussian Elimination to convert the matrix into upper triangular form.
+ * Determinant = product of diagonal elements.
+ *
+ * The elimination is a blocked (right-looking) LU factorization: a panel of
+ * luBlock columns is eliminated with the plain row-by-row method, the block row to
+ * its right is solved against the panel's unit lower triangle, and the trailing
+ * matrix receives one rank-luBlock GEMM update. The trailing matrix is therefore
+ * streamed once per panel instead of once per pivot, which keeps large matrices
+ * compute-bound instead of memory-bound. After the call the grid holds U on and
+ * above the diagonal and the multipliers of L below it.
+ *
+ * Pivoting (-P) decides what happens when a diagonal element is small:
+ *      none      no row exchanges; a pivot below 1e-9 ends with det = 0
+ *      partial   swap in the largest element of the pivot column (default)
+ *      complete  swap in the largest element of the whole trailing matrix
+ *      rook      alternate column/row searches until an element is the largest
+ *                in both its row and its column
+ * Each exchange flips the sign of the determinant. With partial pivoting the swaps
+ * are applied to the panel columns at once and to the rest of the row once per
+ * panel, so the blocked and threaded paths keep their structure. Complete and rook
+ * pivoting also exchange columns, which does not fit a panel; they always run the
+ * unblocked serial elimination. ipiv[i] (cpiv[i]) records the row (column) that
+ * was exchanged with row (column) i at step i.
+ *
+ * With -t the factorization itself runs on several threads, either fork-join with
+ * barriers (luFactorParallel) or, with -d, as a task DAG (luFactorDag).
+ *
+ * The pivots are not multiplied into one double: for n in the thousands that
+ * product leaves the double range long before the solution does. Instead the
+ * factorization returns a LogDet (sign, log|det|) and the solvers form
+ * Xi = det(Ai) / det(A) as sign · exp(log|det(Ai)| − log|det(A)|).
+ *
+ * Time Complexity: O(n³)
+ *****************************************************************************************/
+
+#define LU_BLOCK_DEFAULT 64
+#define PAR_LU_MIN_DIM   256   /* Below this the per-pivot barriers cost more than they save */
+
+#define PIVOT_NONE     0
+#define PIVOT_PARTIAL  1
+#define PIVOT_COMPLETE 2
+#define PIVOT_ROOK     3
+
+static int luBlock = LU_BLOCK_DEFAULT;   /* Panel width, tunable with -b */
+static int pivotMode = PIVOT_PARTIAL;    /* Selected with -P none|partial|complete|rook */
+
+typedef struct
+{
+    int sign;        /* −1, +1, or 0 for a singular matrix */
+    double logAbs;   /* log|det|, −inf when singular */
+} LogDet;
+
+static const LogDet LOGDET_ONE = { 1, 0.0 };
+static const LogDet LOGDET_ZERO = { 0, -INFINITY };
+
+/* d · s */
+static LogDet logDetScale(LogDet d, double s)
+{
+    if (d.sign == 0 || s == 0)
+        return LOGDET_ZERO;
+    d.sign = (s < 0) ? -d.sign : d.sign;
+    d.logAbs += log(fabs(s));
+    return d;
+}
+
+/* d · e */
+static LogDet logDetMul(LogDet d, LogDet e)
+{
+    if (d.sign == 0 || e.sign == 0)
+        return LOGDET_ZERO;
+    d.sign *= e.sign;
+    d.logAbs += e.logAbs;
+    return d;
+}
+
+/* Plain value of d; ±inf or 0 once it leaves the double range */
+double logDetValue(LogDet d)
+{
+    return d.sign ? d.sign * exp(d.logAbs) : 0.0;
+}
+
+/* num / den, formed in log space so that neither has to fit in a double */
+double logDetRatio(LogDet num, LogDet den)
+{
+    if (num.sign == 0)
+        return 0.0;
+    return num.sign * den.sign * exp(num.logAbs - den.logAbs);
+}
+
+/* With pivot row i, eliminate column i from rows [lo, hi), updating columns (i, kEnd) */
+static void luEliminateRows(Grid *g, int i, int kEnd, int lo, int hi)
+{
+    const double *pivotRow = GRID_ROW(g, i);
+    for (int j = lo; j < hi; j++)
+    {
+        double *row = GRID_ROW(g, j);
+        double factor = row[i] / pivotRow[i];
+        row[i] = factor;
+        kern.axpy(row + i + 1, pivotRow + i + 1, factor, kEnd - i - 1);
+    }
+}
+
+/* U12 = L11⁻¹ · A12 restricted to columns [lo, hi) (L11 is unit lower) */
+static void luSolveBlockRow(Grid *g, int k0, int nb, int lo, int hi)
+{
+    for (int i = k0 + 1; i < k0 + nb; i++)
+    {
+        double *row = GRID_ROW(g, i);
+        for (int r = k0; r < i; r++)
+            kern.axpy(row + lo, GRID_ROW(g, r) + lo, row[r], hi - lo);
+    }
+}
+
+/* A22 -= L21 · U12 restricted to columns [lo, hi) of the trailing matrix */
+static void luUpdateTrailing(Grid *g, int k0, int nb, int lo, int hi)
+{
+    int c0 = k0 + nb;
+    kern.gemm(GRID_ROW(g, c0) + lo, g->ld,
+              GRID_ROW(g, c0) + k0, g->ld,
+              GRID_ROW(g, k0) + lo, g->ld,
+              g->n - c0, hi - lo, nb);
+}
+
+/* Row in [lo, hi) holding the largest |element| of column col */
+static int luPivotRow(const Grid *g, int col, int lo, int hi)
+{
+    int best = lo;
+    double big = -1.0;
+    for (int r = lo; r < hi; r++)
+    {
+        double v = fabs(GRID_ROW(g, r)[col]);
+        if (v > big)
+        {
+            big = v;
+            best = r;
+        }
+    }
+    return best;
+}
+
+/* Exchange rows a and b over columns [lo, hi) */
+static void luSwapRange(Grid *g, int a, int b, int lo, int hi)
+{
+    double *ra = GRID_ROW(g, a), *rb = GRID_ROW(g, b);
+    for (int c = lo; c < hi; c++)
+    {
+        double t = ra[c];
+        ra[c] = rb[c];
+        rb[c] = t;
+    }
+}
+
+/* Replay the exchanges ipiv[from .. to) on columns [lo, hi) */
+static void luSwapRows(Grid *g, const int *ipiv, int from, int to, int lo, int hi)
+{
+    if (hi <= lo)
+        return;
+    for (int i = from; i < to; i++)
+        if (ipiv[i] != i)
+            luSwapRange(g, i, ipiv[i], lo, hi);
+}
+
+/* [*lo, *hi) = share `idx` of `parts` of [from, to), inner boundaries multiples of align */
+static void splitRange(int from, int to, int parts, int idx, int align, int *lo, int *hi)
+{
+    long long len = to - from;
+    *lo = from + (int)(len * idx / parts) / align * align;
+    *hi = (idx == parts - 1) ? to : from + (int)(len * (idx + 1) / parts) / align * align;
+}
+
+/* Unblocked elimination with complete or rook pivoting (rows and columns exchanged) */
+static LogDet luFactorFull(Grid *g, int *ipiv, int *cpiv)
+{
+    int n = g->n;
+    LogDet det = LOGDET_ONE;
+
+    for (int i = 0; i < n; i++)
+    {
+        int p = i, q = i;
+
+        if (pivotMode == PIVOT_COMPLETE)
+        {
+            double big = -1.0;
+            for (int c = i; c < n; c++)
+            {
+                int r = luPivotRow(g, c, i, n);
+                if (fabs(GRID_ROW(g, r)[c]) > big)
+                {
+                    big = fabs(GRID_ROW(g, r)[c]);
+                    p = r;
+                    q = c;
+                }
+            }
+        }
+        else
+        {
+            /* Rook: the candidate grows strictly, so the walk ends */
+            p = luPivotRow(g, i, i, n);
+            for (;;)
+            {
+                const double *row = GRID_ROW(g, p);
+                int c = q;
+                for (int k = i; k < n; k++)
+                    if (fabs(row[k]) > fabs(row[c]))
+                        c = k;
+                if (c == q)
+                    break;
+                q = c;
+                int r = luPivotRow(g, q, i, n);
+                if (fabs(GRID_ROW(g, r)[q]) <= fabs(GRID_ROW(g, p)[q]))
+                    break;
+                p = r;
+            }
+        }
+
+        ipiv[i] = p;
+        cpiv[i] = q;
+
+        /* The largest candidate is near zero, so the matrix is singular */
+        if (fabs(GRID_ROW(g, p)[q]) < 1e-9)
+            return LOGDET_ZERO;
+
+        if (p != i)
+        {
+            luSwapRange(g, i, p, 0, n);
+            det.sign = -det.sign;
+        }
+        if (q != i)
+        {
+            for (int r = 0; r < n; r++)
+            {
+                double *row = GRID_ROW(g, r);
+                double t = row[i];
+                row[i] = row[q];
+                row[q] = t;
+            }
+            det.sign = -det.sign;
+        }
+        det = logDetScale(det, GRID_ROW(g, i)[i]);
+
+        luEliminateRows(g, i, n, i + 1, n);
+    }
+    return det;
+}
+
+static LogDet luFactorParallel(Grid *g, int nb, int threads, int *ipiv);
+static LogDet luFactorDag(Grid *g, int nb, int *ipiv);
+static int dagLU;
+
+/*
+ * In-place blocked LU; returns det(A), with sign 0 if the matrix is (numerically)
+ * singular. ipiv and cpiv (n entries each) receive the exchanges and may be NULL.
+ * Without column pivoting cpiv is the identity.
+ */
+LogDet luFactor(Grid *g, int nb, int *ipiv, int *cpiv)
+{
+    int n = g->n;
+    LogDet det = LOGDET_ONE;
+    int *own = NULL;
+
+    if (nb < 1) nb = 1;
+
+    if (!ipiv)
+        ipiv = own = malloc((n ? n : 1) * sizeof(int));
+
+    if (pivotMode == PIVOT_COMPLETE || pivotMode == PIVOT_ROOK)
+    {
+        int *cown = cpiv ? NULL : malloc((n ? n : 1) * sizeof(int));
+        det = luFactorFull(g, ipiv, cpiv ? cpiv : cown);
+        free(cown);
+        free(own);
+        return det;
+    }
+    if (cpiv)
+        for (int i = 0; i < n; i++)
+            cpiv[i] = i;
+
+    int threads = (detThreads > 0) ? detThreads : poolSize(1 << 30);
+    if (threads > 1 && n >= PAR_LU_MIN_DIM && !insideTeam)
+    {
+        det = dagLU ? luFactorDag(g, nb, ipiv) : luFactorParallel(g, nb, threads, ipiv);
+        free(own);
+        return det;
+    }
+
+    for (int k0 = 0; k0 < n; k0 += nb)
+    {
+        int kb = (n - k0 < nb) ? n - k0 : nb;
+
+        for (int i = k0; i < k0 + kb; i++)
+        {
+            int p = (pivotMode == PIVOT_NONE) ? i : luPivotRow(g, i, i, n);
+            ipiv[i] = p;
+
+            /* If pivot element is near zero, determinant becomes zero */
+            if (fabs(GRID_ROW(g, p)[i]) < 1e-9)
+            {
+                free(own);
+                return LOGDET_ZERO;
+            }
+            if (p != i)
+            {
+                luSwapRange(g, i, p, k0, k0 + kb);
+                det.sign = -det.sign;
+            }
+            det = logDetScale(det, GRID_ROW(g, i)[i]);
+
+            luEliminateRows(g, i, k0 + kb, i + 1, n);
+        }
+
+        /* Catch up the rest of the panel's rows with its exchanges */
+        luSwapRows(g, ipiv, k0, k0 + kb, 0, k0);
+
+        int c0 = k0 + kb;
+        if (c0 < n)
+        {
+            luSwapRows(g, ipiv, k0, k0 + kb, c0, n);
+            luSolveBlockRow(g, k0, kb, c0, n);
+            luUpdateTrailing(g, k0, kb, c0, n);
+        }
+    }
+    free(own);
+    return det;
+}
+
+/*
+ * Parallel version of the same factorization on the shared thread team.
+ * Panel: the rows below each pivot are split across the threads, with one
+ * barrier per pivot (three with partial pivoting: search, exchange, eliminate).
+ * Trailing matrix: every thread owns a slice of the columns right of the panel,
+ * replays the panel's row exchanges on it, solves its part of U12 and applies the
+ * GEMM update to it, so the only synchronisation is one barrier per panel. This
+ * also covers the det(A) prefix that every Cramer solver computes before fanning out.
+ */
+typedef struct
+{
+    Grid *g;
+    int nb;
+    int threads;                /* Team members taking part */
+    pthread_barrier_t sync;
+    LogDet det;                 /* Product of pivots, kept by tid 0 */
+    int *ipiv;
+    int *cand;                  /* Per-thread pivot candidate for the current column */
+    int singular;               /* Set by tid 0 when no usable pivot is left */
+} LUJob;
+
+static void luTask(void *arg, int tid, int nthreads)
+{
+    LUJob *job = arg;
+    Grid *g = job->g;
+    int n = g->n, p = job->threads, lo, hi;
+    (void)nthreads;
+
+    if (tid >= p)
+        return;
+
+    for (int k0 = 0; k0 < n; k0 += job->nb)
+    {
+        int kb = (n - k0 < job->nb) ? n - k0 : job->nb;
+
+        for (int i = k0; i < k0 + kb; i++)
+        {
+            if (pivotMode != PIVOT_NONE)
+            {
+                splitRange(i, n, p, tid, 1, &lo, &hi);
+                job->cand[tid] = (hi > lo) ? luPivotRow(g, i, lo, hi) : -1;
+                pthread_barrier_wait(&job->sync);
+
+                if (tid == 0)
+                {
+                    int best = i;
+                    for (int t = 0; t < p; t++)
+                        if (job->cand[t] >= 0 &&
+                            fabs(GRID_ROW(g, job->cand[t])[i]) > fabs(GRID_ROW(g, best)[i]))
+                            best = job->cand[t];
+                    job->ipiv[i] = best;
+                    if (best != i)
+                    {
+                        luSwapRange(g, i, best, k0, k0 + kb);
+                        job->det.sign = -job->det.sign;
+                    }
+                }
+                pthread_barrier_wait(&job->sync);
+            }
+            else if (tid == 0)
+            {
+                job->ipiv[i] = i;
+            }
+
+            /* Every thread sees the same finished pivot, so all leave together */
+            if (fabs(GRID_ROW(g, i)[i]) < 1e-9)
+            {
+                if (tid == 0)
+                    job->singular = 1;
+                return;
+            }
+            if (tid == 0)
+                job->det = logDetScale(job->det, GRID_ROW(g, i)[i]);
+
+            splitRange(i + 1, n, p, tid, 1, &lo, &hi);
+            luEliminateRows(g, i, k0 + kb, lo, hi);
+            pthread_barrier_wait(&job->sync);
+        }
+
+        splitRange(0, k0, p, tid, 1, &lo, &hi);
+        luSwapRows(g, job->ipiv, k0, k0 + kb, lo, hi);
+
+        int c0 = k0 + kb;
+        if (c0 < n)
+        {
+            splitRange(c0, n, p, tid, 2 * GRID_PAD, &lo, &hi);
+            if (hi > lo)
+            {
+                luSwapRows(g, job->ipiv, k0, k0 + kb, lo, hi);
+                luSolveBlockRow(g, k0, kb, lo, hi);
+                luUpdateTrailing(g, k0, kb, lo, hi);
+            }
+            pthread_barrier_wait(&job->sync);
+        }
+    }
+}
+
+static LogDet luFactorParallel(Grid *g, int nb, int threads, int *ipiv)
+{
+    ThreadTeam *t = sharedTeam();
+    LUJob job;
+
+    job.g = g;
+    job.nb = nb;
+    job.threads = (threads < t->size) ? threads : t->size;
+    job.det = LOGDET_ONE;
+    job.ipiv = ipiv;
+    job.cand = malloc(job.threads * sizeof(int));
+    job.singular = 0;
+    pthread_barrier_init(&job.sync, NULL, job.threads);
+
+    teamRun(t, luTask, &job);
+
+    pthread_barrier_destroy(&job.sync);
+    free(job.cand);
+    return job.singular ? LOGDET_ZERO : job.det;
+}
+
+/*****************************************************************************************
+ * TASK-DAG LU SCHEDULER
+ *
+ * The fork-join factorization above idles threads at every barrier. Here the same
+ * blocked LU is cut into nb × nb tiles and expressed as a DAG of tile tasks:
+ *      PANEL(k)     eliminate column block k over all rows below the diagonal
+ *      TRSM(k, j)   solve tile (k, j) of the block row against L(k, k)
+ *      GEMM(k, i, j) tile (i, j) -= L(i, k) · U(k, j)
+ * A task becomes ready as soon as its own inputs are final, so PANEL(k + 1) starts
+ * once column block k + 1 has received its step-k updates, while the rest of the
+ * step-k GEMMs are still running (lookahead).
+ *
+ * With partial pivoting PANEL(k) exchanges rows only inside its own column block;
+ * TRSM(k, j) replays those exchanges on column block j first, so it waits until
+ * every tile of that column below row block k has its step k − 1 update. The
+ * exchanges on the L columns left of each panel are replayed once the DAG is done.
+ *
+ * The scheduler keeps one deque per worker. Owners pop from the bottom, idle
+ * workers steal from the top. Tasks on the critical path (the panel and everything
+ * feeding column block k + 1) are pushed to the bottom so their owner runs them
+ * next; bulk GEMMs go to the top where thieves pick them up.
+ *
+ * Several DAGs can be in flight at once: a DagGroup collects finished DAGs, which
+ * lets the Cramer driver keep all n + 1 determinants flowing through one scheduler.
+ *****************************************************************************************/
+
+#define TASK_PANEL 0
+#define TASK_TRSM  1
+#define TASK_GEMM  2
+
+static int dagLU = 0;   /* Use the DAG scheduler for threaded determinants (-d) */
+
+struct LUDag;
+
+typedef struct
+{
+    struct LUDag *dag;
+    int type;
+    int k, i, j;
+} DagTask;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    DagTask *buf;      /* Ring buffer; buf[head] is the top */
+    int cap;
+    int head;
+    int count;
+} TaskDeque;
+
+typedef struct DagGroup
+{
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    struct LUDag *finished;    /* Finished DAGs not yet collected (linked list) */
+} DagGroup;
+
+typedef struct LUDag
+{
+    Grid *g;
+    int nb;
+    int tiles;                 /* Tiles per dimension */
+    pthread_mutex_t lock;      /* Guards the dependency state below */
+    int *colStep;              /* Step column block j is being prepared for */
+    int *colWait;              /* GEMMs of the previous step still due on column block j */
+    unsigned char *panelDone;  /* PANEL(k) finished */
+    int remaining;             /* Tasks not yet finished */
+    int *ipiv;                 /* Row exchanges chosen by the panels */
+    LogDet det;
+    atomic_int failed;         /* A pivot vanished; the rest of the DAG is skipped */
+    DagGroup *group;
+    struct LUDag *next;        /* Link in the group's finished list */
+    int tag;                   /* Caller's label (column index in the Cramer driver) */
+} LUDag;
+
+typedef struct
+{
+    int size;
+    pthread_t *threads;
+    TaskDeque *deques;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    atomic_int queued;         /* Tasks sitting in some deque */
+    atomic_int nextDeque;      /* Round robin for pushes from outside the pool */
+    int quit;
+} Scheduler;
+
+static Scheduler sched;
+static int schedReady = 0;
+static __thread int schedSelf = -1;   /* Deque owned by this thread, −1 outside the pool */
+
+static void dequePush(TaskDeque *q, DagTask t, int bottom)
+{
+    pthread_mutex_lock(&q->lock);
+    if (q->count == q->cap)
+    {
+        int cap = q->cap ? 2 * q->cap : 64;
+        DagTask *buf = malloc(cap * sizeof(DagTask));
+        for (int i = 0; i < q->count; i++)
+            buf[i] = q->buf[(q->head + i) % q->cap];
+        free(q->buf);
+        q->buf = buf;
+        q->cap = cap;
+        q->head = 0;
+    }
+    if (bottom)
+    {
+        q->buf[(q->head + q->count) % q->cap] = t;
+    }
+    else
+    {
+        q->head = (q->head + q->cap - 1) % q->cap;
+        q->buf[q->head] = t;
+    }
+    q->count++;
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Owner takes from the bottom, thieves from the top */
+static int dequeTake(TaskDeque *q, DagTask *t, int bottom)
+{
+    int got = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->count > 0)
+    {
+        if (bottom)
+        {
+            *t = q->buf[(q->head + q->count - 1) % q->cap];
+        }
+        else
+        {
+            *t = q->buf[q->head];
+            q->head = (q->head + 1) % q->cap;
+        }
+        q->count--;
+        got = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+/* Make a task runnable; urgent tasks are run next by the pushing worker */
+static void schedPush(LUDag *d, int type, int k, int i, int j, int urgent)
+{
+    DagTask t = { d, type, k, i, j };
+    int q = schedSelf;
+    if (q < 0)
+        q = atomic_fetch_add(&sched.nextDeque, 1) % sched.size;
+
+    dequePush(&sched.deques[q], t, urgent);
+    atomic_fetch_add(&sched.queued, 1);
+
+    pthread_mutex_lock(&sched.lock);
+    pthread_cond_signal(&sched.work);
+    pthread_mutex_unlock(&sched.lock);
+}
+
+static int schedTake(int self, DagTask *t)
+{
+    if (dequeTake(&sched.deques[self], t, 1))
+        return 1;
+    for (int v = 1; v < sched.size; v++)
+        if (dequeTake(&sched.deques[(self + v) % sched.size], t, 0))
+            return 1;
+    return 0;
+}
+
+/* Run one tile task on the grid (skipped once the DAG has failed) */
+static void dagCompute(LUDag *d, const DagTask *t)
+{
+    Grid *g = d->g;
+    int n = g->n, nb = d->nb;
+    int k0 = t->k * nb, kb = (n - k0 < nb) ? n - k0 : nb;
+
+    if (d->failed)
+        return;
+
+    if (t->type == TASK_PANEL)
+    {
+        LogDet det = LOGDET_ONE;
+        for (int i = k0; i < k0 + kb; i++)
+        {
+            int p = (pivotMode == PIVOT_NONE) ? i : luPivotRow(g, i, i, n);
+            d->ipiv[i] = p;
+            if (fabs(GRID_ROW(g, p)[i]) < 1e-9)
+            {
+                d->failed = 1;
+                return;
+            }
+            if (p != i)
+            {
+                luSwapRange(g, i, p, k0, k0 + kb);
+                det.sign = -det.sign;
+            }
+            det = logDetScale(det, GRID_ROW(g, i)[i]);
+            luEliminateRows(g, i, k0 + kb, i + 1, n);
+        }
+        d->det = logDetMul(d->det, det);   // Panels run one after another, so no race here
+    }
+    else
+    {
+        int j0 = t->j * nb, j1 = (j0 + nb < n) ? j0 + nb : n;
+        if (t->type == TASK_TRSM)
+        {
+            luSwapRows(g, d->ipiv, k0, k0 + kb, j0, j1);
+            luSolveBlockRow(g, k0, kb, j0, j1);
+        }
+        else
+        {
+            int i0 = t->i * nb, i1 = (i0 + nb < n) ? i0 + nb : n;
+            kern.gemm(GRID_ROW(g, i0) + j0, g->ld,
+                      GRID_ROW(g, i0) + k0, g->ld,
+                      GRID_ROW(g, k0) + j0, g->ld,
+                      i1 - i0, j1 - j0, kb);
+        }
+    }
+}
+
+/* Record a finished task and push every task it made ready */
+static void dagRelease(LUDag *d, const DagTask *t)
+{
+    int T = d->tiles, k = t->k;
+    int finished;
+
+    pthread_mutex_lock(&d->lock);
+    if (t->type == TASK_PANEL)
+    {
+        d->panelDone[k] = 1;
+        for (int j = k + 1; j < T; j++)
+            if (d->colStep[j] == k && d->colWait[j] == 0)
+                schedPush(d, TASK_TRSM, k, k, j, j == k + 1);
+    }
+    else if (t->type == TASK_TRSM)
+    {
+        int j = t->j;
+        d->colStep[j] = k + 1;
+        d->colWait[j] = T - k - 1;   // GEMM(k, i, j) for i = k + 1 .. T − 1
+        for (int i = k + 1; i < T; i++)
+            schedPush(d, TASK_GEMM, k, i, j, j == k + 1);
+    }
+    else
+    {
+        int j = t->j;
+        if (--d->colWait[j] == 0)
+        {
+            /* Column block j is final for step k + 1 */
+            if (j == k + 1)
+                schedPush(d, TASK_PANEL, j, j, j, 1);
+            else if (d->panelDone[k + 1])
+                schedPush(d, TASK_TRSM, k + 1, k + 1, j, j == k + 2);
+        }
+    }
+    finished = (--d->remaining == 0);
+    pthread_mutex_unlock(&d->lock);
+
+    if (finished)
+    {
+        DagGroup *grp = d->group;
+        pthread_mutex_lock(&grp->lock);
+        d->next = grp->finished;
+        grp->finished = d;
+        pthread_cond_broadcast(&grp->done);
+        pthread_mutex_unlock(&grp->lock);
+    }
+}
+
+static void *schedThread(void *arg)
+{
+    int self = (int)(long)arg;
+    DagTask t;
+
+    schedSelf = self;
+    insideTeam = 1;   // Determinants inside tasks must not post nested work
+    placeWorker(0, self);
+
+    for (;;)
+    {
+        if (schedTake(self, &t))
+        {
+            atomic_fetch_sub(&sched.queued, 1);
+            dagCompute(t.dag, &t);
+            dagRelease(t.dag, &t);
+            continue;
+        }
+
+        pthread_mutex_lock(&sched.lock);
+        while (atomic_load(&sched.queued) == 0 && !sched.quit)
+            pthread_cond_wait(&sched.work, &sched.lock);
+        int quit = sched.quit && atomic_load(&sched.queued) == 0;
+        pthread_mutex_unlock(&sched.lock);
+        if (quit)
+            break;
+    }
+    return NULL;
+}
+
+/* Start the scheduler on first use, sized like the thread team */
+static void schedStart(void)
+{
+    if (schedReady)
+        return;
+
+    int size = poolSize(1 << 30);
+    if (detThreads > size)
+        size = detThreads;
+
+    memset(&sched, 0, sizeof(sched));
+    sched.size = size;
+    sched.threads = calloc(size, sizeof(pthread_t));
+    sched.deques = calloc(size, sizeof(TaskDeque));
+    pthread_mutex_init(&sched.lock, NULL);
+    pthread_cond_init(&sched.work, NULL);
+    for (int i = 0; i < size; i++)
+        pthread_mutex_init(&sched.deques[i].lock, NULL);
+
+    for (int i = 0; i < size; i++)
+        if (pthread_create(&sched.threads[i], NULL, schedThread, (void *)(long)i) != 0)
+        {
+            perror("pthread_create");
+            exit(1);
+        }
+    schedReady = 1;
+}
+
+void schedStop(void)
+{
+    if (!schedReady)
+        return;
+
+    pthread_mutex_lock(&sched.lock);
+    sched.quit = 1;
+    pthread_cond_broadcast(&sched.work);
+    pthread_mutex_unlock(&sched.lock);
+
+    for (int i = 0; i < sched.size; i++)
+        pthread_join(sched.threads[i], NULL);
+    for (int i = 0; i < sched.size; i++)
+    {
+        pthread_mutex_destroy(&sched.deques[i].lock);
+        free(sched.deques[i].buf);
+    }
+    free(sched.threads);
+    free(sched.deques);
+    pthread_mutex_destroy(&sched.lock);
+    pthread_cond_destroy(&sched.work);
+    schedReady = 0;
+}
+
+void groupInit(DagGroup *grp)
+{
+    pthread_mutex_init(&grp->lock, NULL);
+    pthread_cond_init(&grp->done, NULL);
+    grp->finished = NULL;
+}
+
+void groupDestroy(DagGroup *grp)
+{
+    pthread_mutex_destroy(&grp->lock);
+    pthread_cond_destroy(&grp->done);
+}
+
+/* Block until some DAG of the group finishes and return it */
+LUDag *groupWait(DagGroup *grp)
+{
+    pthread_mutex_lock(&grp->lock);
+    while (!grp->finished)
+        pthread_cond_wait(&grp->done, &grp->lock);
+    LUDag *d = grp->finished;
+    grp->finished = d->next;
+    pthread_mutex_unlock(&grp->lock);
+    return d;
+}
+
+/* Queue an in-place factorization of g; its LUDag lands in grp when done */
+void dagSubmit(LUDag *d, Grid *g, int nb, DagGroup *grp, int tag)
+{
+    int n = g->n;
+    int T = (n + nb - 1) / nb;
+
+    schedStart();
+
+    d->g = g;
+    d->nb = nb;
+    d->tiles = T;
+    d->colStep = calloc(T, sizeof(int));
+    d->colWait = calloc(T, sizeof(int));
+    d->panelDone = calloc(T, 1);
+    d->ipiv = malloc((n ? n : 1) * sizeof(int));
+    d->det = LOGDET_ONE;
+    d->failed = 0;
+    d->group = grp;
+    d->tag = tag;
+    pthread_mutex_init(&d->lock, NULL);
+
+    d->remaining = 0;
+    for (int k = 0; k < T; k++)
+    {
+        int rest = T - k - 1;
+        d->remaining += 1 + rest + rest * rest;
+    }
+
+    if (n > 0)
+        schedPush(d, TASK_PANEL, 0, 0, 0, 1);
+}
+
+/*
+ * Free the bookkeeping of a finished DAG and return det (sign 0 if a pivot vanished).
+ * If ipiv is given the caller wants the factors: the row exchanges are copied out
+ * and replayed on the L columns left of each panel.
+ */
+LogDet dagFinish(LUDag *d, int *ipiv)
+{
+    if (ipiv && !d->failed)
+    {
+        int n = d->g->n;
+        memcpy(ipiv, d->ipiv, n * sizeof(int));
+        for (int k0 = d->nb; k0 < n; k0 += d->nb)
+            luSwapRows(d->g, ipiv, k0, (k0 + d->nb < n) ? k0 + d->nb : n, 0, k0);
+    }
+
+    pthread_mutex_destroy(&d->lock);
+    free(d->colStep);
+    free(d->colWait);
+    free(d->panelDone);
+    free(d->ipiv);
+    return d->failed ? LOGDET_ZERO : d->det;
+}
+
+static LogDet luFactorDag(Grid *g, int nb, int *ipiv)
+{
+    DagGroup grp;
+    LUDag d;
+
+    if (g->n == 0)
+        return LOGDET_ONE;
+
+    groupInit(&grp);
+    dagSubmit(&d, g, nb, &grp, 0);
+    groupWait(&grp);
+    groupDestroy(&grp);
+    return dagFinish(&d, ipiv);
+}
+
+/*****************************************************************************************
+ * SMALL FIXED-SIZE KERNELS
+ *
+ * For n ≤ SMALL_DIM_MAX the blocked LU is mostly overhead: panel bookkeeping, pivot
+ * arrays, kernel calls through pointers on rows a few doubles wide. Every such n
+ * gets its own determinant and Cramer kernel instead, generated by macro with n as
+ * a compile-time constant so that the compiler unrolls the row loops and keeps
+ * the matrix in a local array: partial-pivoting elimination on an N × N stack
+ * array, with the same 1e-9 pivot cut-off as luFactor. Even for n = 2..4 there is
+ * no closed-form cofactor expansion: it has no pivots to test, so a near-singular
+ * system would get a finite answer here and "singular" from the parallel
+ * backends, which factor A with luFactor.
+ * calcLogDet and linearSolveSeq (Cramer mode) dispatch to them on n when partial
+ * pivoting is selected; smallKernels = 0 restores the general path (-F compares).
+ *****************************************************************************************/
+
+#define SMALL_DIM_MAX 16   /* Largest n with a specialized kernel */
+
+static int smallKernels = 1;
+
+/* Elimination of the n × n row-major matrix a (destroyed); n is a constant at every call */
+static inline __attribute__((always_inline)) double smallDetBody(double *a, int n)
+{
+    double det = 1;
+
+    /* Unrolling the k loop as well only bloats the code past what it saves */
+    for (int k = 0; k < n; k++)
+    {
+        int p = k;
+        double best = fabs(a[k * n + k]);
+#pragma GCC unroll 16
+        for (int r = k + 1; r < n; r++)
+        {
+            double v = fabs(a[r * n + k]);
+            p = (v > best) ? r : p;
+            best = (v > best) ? v : best;
+        }
+
+        /* Same cut-off as luFactor */
+        if (best < 1e-9)
+            return 0;
+        if (p != k)
+        {
+#pragma GCC unroll 16
+            for (int j = k; j < n; j++)
+            {
+                double t = a[k * n + j];
+                a[k * n + j] = a[p * n + j];
+                a[p * n + j] = t;
+            }
+            det = -det;
+        }
+
+        double pivot = a[k * n + k], inv = 1 / pivot;
+        det *= pivot;
+#pragma GCC unroll 16
+        for (int i = k + 1; i < n; i++)
+        {
+            double f = a[i * n + k] * inv;
+#pragma GCC unroll 16
+            for (int j = k + 1; j < n; j++)
+                a[i * n + j] -= f * a[k * n + j];
+        }
+    }
+    return det;
+}
+
+#define SMALL_DET(a, N) smallDetBody(a, N)
+
+/*
+ * smallDetN(g): det of the N × N grid g (left unchanged).
+ * smallCramerN(A, B, X, D): Xi = det(Ai) / det(A) and, if D is given, det(Ai);
+ * returns det(A) and leaves X alone when it is 0.
+ */
+#define DEFINE_SMALL_KERNELS(N)                                                         \
+    static double smallDet##N(const Grid *g)                                            \
+    {                                                                                   \
+        double a[N * N];                                                                \
+        for (int i = 0; i < N; i++)                                                     \
+            memcpy(a + i * N, GRID_ROW(g, i), N * sizeof(double));                      \
+        return SMALL_DET(a, N);                                                         \
+    }                                                                                   \
+                                                                                        \
+    static double smallCramer##N(const Grid *A, const double *B, double *X, double *D) \
+    {                                                                                   \
+        double a[N * N], m[N * N];                                                      \
+        for (int i = 0; i < N; i++)                                                     \
+            memcpy(a + i * N, GRID_ROW(A, i), N * sizeof(double));                      \
+        memcpy(m, a, sizeof(a));                                                        \
+        double det = SMALL_DET(m, N);                                                   \
+        if (det == 0)                                                                   \
+            return 0;                                                                   \
+        for (int i = 0; i < N; i++)                                                     \
+        {                                                                               \
+            memcpy(m, a, sizeof(a));                                                    \
+            for (int r = 0; r < N; r++)                                                 \
+                m[r * N + i] = B[r];                                                    \
+            double d = SMALL_DET(m, N);                                                 \
+            X[i] = d / det;                                                             \
+            if (D)                                                                      \
+                D[i] = d;                                                               \
+        }                                                                               \
+        return det;                                                                     \
+    }
+
+#define SMALL_DIMS(X) \
+    X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16)
+
+SMALL_DIMS(DEFINE_SMALL_KERNELS)
+
+typedef double (*SmallDetKernel)(const Grid *g);
+typedef double (*SmallCramerKernel)(const Grid *A, const double *B, double *X, double *D);
+
+#define SMALL_DET_ENTRY(N)    [N] = smallDet##N,
+#define SMALL_CRAMER_ENTRY(N) [N] = smallCramer##N,
+
+static const SmallDetKernel smallDet[SMALL_DIM_MAX + 1] = { SMALL_DIMS(SMALL_DET_ENTRY) };
+static const SmallCramerKernel smallCramer[SMALL_DIM_MAX + 1] = { SMALL_DIMS(SMALL_CRAMER_ENTRY) };
+
+/* Whether an n × n problem goes to the fixed-size kernels */
+static int useSmallKernel(int n)
+{
+    return smallKernels && pivotMode == PIVOT_PARTIAL && n >= 2 && n <= SMALL_DIM_MAX;
+}
+
+/* (sign, log|det|) of the grid, which is overwritten by its LU factors unless n is small */
+LogDet calcLogDet(Grid *grid)
+{
+    if (useSmallKernel(grid->n))
+        return logDetScale(LOGDET_ONE, smallDet[grid->n](grid));
+    return luFactor(grid, luBlock, NULL, NULL);
+}
+
+double calcDet(Grid *grid)
+{
+    return logDetValue(calcLogDet(grid));
+}
+
+/*
+ * First elimination step of A with column col replaced by vec (col < 0: A itself),
+ * read straight from A. The pivot is chosen in column 0 of the replaced matrix and
+ * every other row is written to `work` once, already updated, so no n × n copy is
+ * made and A is never written. Afterwards work is the (n − 1) × (n − 1) Schur
+ * complement (work->n = n − 1; the buffer must hold n × n). Returns the step's
+ * contribution to the determinant: ±pivot, or LOGDET_ZERO if the pivot vanishes.
+ */
+LogDet luFirstStep(const Grid *A, const double *vec, int col, Grid *work)
+{
+    int n = A->n, p = 0;
+    double *pivotRow = GRID_ROW(work, n - 1);   // The Schur complement leaves the last row free
+
+#define VIEW0(r) ((col == 0) ? vec[r] : GRID_ROW(A, r)[0])
+    if (pivotMode != PIVOT_NONE)
+        for (int r = 1; r < n; r++)
+            if (fabs(VIEW0(r)) > fabs(VIEW0(p)))
+                p = r;
+    if (fabs(VIEW0(p)) < 1e-9)
+        return LOGDET_ZERO;
+
+    memcpy(pivotRow, GRID_ROW(A, p), n * sizeof(double));
+    if (col >= 0)
+        pivotRow[col] = vec[p];
+
+    for (int r = 1; r < n; r++)
+    {
+        int s = (r == p) ? 0 : r;   // Row p moves to the top, row 0 takes its place
+        double *dst = GRID_ROW(work, r - 1);
+
+        memcpy(dst, GRID_ROW(A, s) + 1, (n - 1) * sizeof(double));
+        if (col > 0)
+            dst[col - 1] = vec[s];
+        kern.axpy(dst, pivotRow + 1, VIEW0(s) / pivotRow[0], n - 1);
+    }
+#undef VIEW0
+
+    work->n = n - 1;
+    LogDet lead = { (p != 0) ? -1 : 1, 0.0 };
+    return logDetScale(lead, pivotRow[0]);
+}
+
+/*
+ * det of A with column col replaced by vec, the Cramer step without cloneGrid +
+ * swapColumn: luFirstStep reads A in place and the blocked LU continues on the
+ * trailing view. Small n and column pivoting keep the copy. `work` (n × n) is
+ * scratch.
+ */
+LogDet calcLogDetReplaced(const Grid *A, const double *vec, int col, Grid *work)
+{
+    int n = A->n;
+
+    if (n < 2 || useSmallKernel(n) || pivotMode == PIVOT_COMPLETE || pivotMode == PIVOT_ROOK)
+    {
+        cloneGrid(A, work);
+        if (col >= 0)
+            swapColumn(work, vec, col);
+        return calcLogDet(work);
+    }
+
+    LogDet det = luFirstStep(A, vec, col, work);
+    if (det.sign != 0)
+        det = logDetMul(det, calcLogDet(work));
+    work->n = n;
+    return det;
+}
+
+/*****************************************************************************************
+ * EXACT INTEGER DETERMINANT (BAREISS)
+ *
+ * The driver fills A and B with small integers, so their determinants are integers
+ * too. With -m exact they are computed exactly by Bareiss' fraction-free
+ * elimination:
+ *      M[i][j] ← (M[k][k] · M[i][j] − M[i][k] · M[k][j]) / M[k−1][k−1]    (i, j > k)
+ * Every division is exact and every intermediate is a minor of A, so the entries
+ * never grow beyond the Hadamard bound Π ‖row i‖ and no threshold is needed: a
+ * pivot is usable exactly when it is non-zero. det(A) is the last pivot.
+ *
+ * The elimination first runs on int64 entries with __int128 products. When a
+ * quotient leaves the int64 range it restarts on multi-precision integers, with
+ * the limbs per entry sized from the Hadamard bound of the input. The update of
+ * one step touches every row below the pivot independently, so with -t the rows
+ * are split across the thread team with one barrier per step, as in the floating
+ * point factorization.
+ *
+ * A and the replaced column must hold integers; other values are rounded.
+ *****************************************************************************************/
+
+#define EXACT_PAR_MIN_DIM 32             /* Below this the per-step barriers dominate */
+#define EXACT_SMALL_LIMIT (1LL << 62)    /* Keeps both __int128 products from overflowing */
+
+typedef struct
+{
+    int sign;          /* −1, 0 or +1 */
+    int len;           /* Limbs in use */
+    uint64_t *limb;    /* Magnitude, least significant limb first */
+} BigInt;
+
+void bigFree(BigInt *x)
+{
+    free(x->limb);
+    x->limb = NULL;
+    x->len = x->sign = 0;
+}
+
+/* |x| ≈ m · 2^e from the top two limbs */
+static double bigTop(const BigInt *x, long *e)
+{
+    int l = x->len;
+    if (l == 1)
+    {
+        *e = 0;
+        return (double)x->limb[0];
+    }
+    *e = 64L * (l - 2);
+    return (double)x->limb[l - 1] * 18446744073709551616.0 + (double)x->limb[l - 2];
+}
+
+/* Plain value of x; ±inf once it leaves the double range */
+double bigToDouble(const BigInt *x)
+{
+    long e;
+    if (x->sign == 0)
+        return 0.0;
+    double m = bigTop(x, &e);
+    return x->sign * ldexp(m, (int)e);
+}
+
+/* num / den rounded to a double, without converting either on its own */
+double bigRatio(const BigInt *num, const BigInt *den)
+{
+    long en, ed;
+    if (num->sign == 0)
+        return 0.0;
+    double mn = bigTop(num, &en), md = bigTop(den, &ed);
+    return num->sign * den->sign * ldexp(mn / md, (int)(en - ed));
+}
+
+LogDet bigToLogDet(const BigInt *x)
+{
+    long e;
+    if (x->sign == 0)
+        return LOGDET_ZERO;
+    double m = bigTop(x, &e);
+    LogDet d = { x->sign, log(m) + e * M_LN2 };
+    return d;
+}
+
+/* Magnitude helpers: little-endian limb arrays, lengths without leading zeros */
+
+static int magNorm(const uint64_t *a, int la)
+{
+    while (la > 0 && a[la - 1] == 0)
+        la--;
+    return la;
+}
+
+static int magCmp(const uint64_t *a, int la, const uint64_t *b, int lb)
+{
+    if (la != lb)
+        return (la > lb) ? 1 : -1;
+    for (int i = la - 1; i >= 0; i--)
+        if (a[i] != b[i])
+            return (a[i] > b[i]) ? 1 : -1;
+    return 0;
+}
+
+/* r = a · b (r must not alias a or b) */
+static int magMul(uint64_t *r, const uint64_t *a, int la, const uint64_t *b, int lb)
+{
+    if (la == 0 || lb == 0)
+        return 0;
+    memset(r, 0, (la + lb) * sizeof(uint64_t));
+    for (int i = 0; i < la; i++)
+    {
+        unsigned __int128 carry = 0;
+        for (int j = 0; j < lb; j++)
+        {
+            carry += (unsigned __int128)a[i] * b[j] + r[i + j];
+            r[i + j] = (uint64_t)carry;
+            carry >>= 64;
+        }
+        r[i + lb] = (uint64_t)carry;
+    }
+    return magNorm(r, la + lb);
+}
+
+/* r = a + b */
+static int magAdd(uint64_t *r, const uint64_t *a, int la, const uint64_t *b, int lb)
+{
+    if (la < lb)
+    {
+        const uint64_t *t = a; a = b; b = t;
+        int l = la; la = lb; lb = l;
+    }
+    unsigned __int128 carry = 0;
+    for (int i = 0; i < la; i++)
+    {
+        carry += (unsigned __int128)a[i] + (i < lb ? b[i] : 0);
+        r[i] = (uint64_t)carry;
+        carry >>= 64;
+    }
+    r[la] = (uint64_t)carry;
+    return magNorm(r, la + 1);
+}
+
+/* r = a − b for a ≥ b */
+static int magSub(uint64_t *r, const uint64_t *a, int la, const uint64_t *b, int lb)
+{
+    uint64_t borrow = 0;
+    for (int i = 0; i < la; i++)
+    {
+        uint64_t bi = (i < lb) ? b[i] : 0;
+        uint64_t d = a[i] - bi - borrow;
+        borrow = (a[i] < bi) || (a[i] - bi < borrow);
+        r[i] = d;
+    }
+    return magNorm(r, la);
+}
+
+/* r = sa·a − sb·b on signed values; the sign of r goes to *rs */
+static int bigSubSigned(uint64_t *r, int *rs, const uint64_t *a, int la, int sa,
+                        const uint64_t *b, int lb, int sb)
+{
+    int len;
+    sb = -sb;
+    if (lb == 0)
+        sb = 0;
+    if (la == 0)
+        sa = 0;
+
+    if (sa == 0 || sb == 0 || sa == sb)
+    {
+        len = magAdd(r, a, la, b, lb);
+        *rs = sa ? sa : sb;
+    }
+    else if (magCmp(a, la, b, lb) >= 0)
+    {
+        len = magSub(r, a, la, b, lb);
+        *rs = sa;
+    }
+    else
+    {
+        len = magSub(r, b, lb, a, la);
+        *rs = sb;
+    }
+    if (len == 0)
+        *rs = 0;
+    return len;
+}
+
+/* a >>= bits in place */
+static int magShiftRight(uint64_t *a, int la, int bits)
+{
+    int limbs = bits / 64, s = bits % 64;
+    if (limbs >= la)
+        return 0;
+    for (int i = 0; i < la - limbs; i++)
+    {
+        uint64_t lo = a[i + limbs] >> s;
+        uint64_t hi = (s && i + limbs + 1 < la) ? a[i + limbs + 1] << (64 - s) : 0;
+        a[i] = lo | hi;
+    }
+    return magNorm(a, la - limbs);
+}
+
+/*
+ * q = a / b for an odd b that divides a exactly (Jebelean's exact division): each
+ * quotient limb is the low limb of the remainder times b⁻¹ mod 2⁶⁴, so no trial
+ * quotients or normalisation are needed. a is destroyed.
+ */
+static int magDivExact(uint64_t *q, uint64_t *a, int la, const uint64_t *b, int lb, uint64_t binv)
+{
+    if (la < lb)
+        return 0;
+
+    int lq = la - lb + 1;
+    for (int i = 0; i < lq; i++)
+    {
+        uint64_t qi = a[i] * binv;
+        uint64_t carry = 0, borrow = 0;
+
+        q[i] = qi;
+        if (qi == 0)
+            continue;
+        for (int j = 0; j < lb; j++)
+        {
+            unsigned __int128 prod = (unsigned __int128)qi * b[j] + carry;
+            uint64_t lo = (uint64_t)prod, ai = a[i + j];
+            carry = (uint64_t)(prod >> 64);
+            a[i + j] = ai - lo - borrow;
+            borrow = (ai < lo) || (ai - lo < borrow);
+        }
+        /* carry + borrow can need 65 bits, so the tail subtracts it as one __int128 */
+        unsigned __int128 sub = (unsigned __int128)carry + borrow;
+        for (int j = i + lb; j < la && sub; j++)
+        {
+            uint64_t aj = a[j], lo = (uint64_t)sub;
+            a[j] = aj - lo;
+            sub = (sub >> 64) + (aj < lo);
+        }
+    }
+    return magNorm(q, lq);
+}
+
+/* b⁻¹ mod 2⁶⁴ for odd b by Newton iteration (3 → 96 correct bits) */
+static uint64_t limbInverse(uint64_t b)
+{
+    uint64_t x = b;
+    for (int i = 0; i < 5; i++)
+        x *= 2 - b * x;
+    return x;
+}
+
+typedef struct
+{
+    int n;
+    const int64_t *src;        /* Input matrix, row-major n × n */
+    int64_t *small;            /* Fixed-width working copy */
+    int L;                     /* Limbs per multi-precision entry */
+    uint64_t *limb;            /* Multi-precision working copy, entry e at limb[e · L] */
+    int *len;
+    signed char *sign;
+    int threads;               /* Team members taking part */
+    pthread_barrier_t sync;
+    atomic_int overflow;       /* A fixed-width quotient did not fit */
+    int pivotSign;             /* Flipped by every row exchange, kept by tid 0 */
+    int singular;              /* Set by tid 0 when a column has no non-zero pivot */
+} ExactJob;
+
+/* Fixed-width elimination; returns 0 if it overflowed and has to be redone */
+static int bareissSmall(ExactJob *job, int tid)
+{
+    int n = job->n, p = job->threads, lo, hi;
+    int64_t *m = job->small, prev = 1;
+
+    for (int k = 0; k < n; k++)
+    {
+        if (tid == 0)
+        {
+            int r = k;
+            while (r < n && m[(size_t)r * n + k] == 0)
+                r++;
+            if (r == n)
+            {
+                job->singular = 1;
+            }
+            else if (r != k)
+            {
+                for (int j = k; j < n; j++)
+                {
+                    int64_t t = m[(size_t)k * n + j];
+                    m[(size_t)k * n + j] = m[(size_t)r * n + j];
+                    m[(size_t)r * n + j] = t;
+                }
+                job->pivotSign = -job->pivotSign;
+            }
+        }
+        pthread_barrier_wait(&job->sync);
+        if (job->singular || k == n - 1)
+            return 1;
+
+        const int64_t *pivotRow = m + (size_t)k * n;
+        int64_t akk = pivotRow[k];
+        splitRange(k + 1, n, p, tid, 1, &lo, &hi);
+        for (int i = lo; i < hi && !atomic_load_explicit(&job->overflow, memory_order_relaxed); i++)
+        {
+            int64_t *row = m + (size_t)i * n;
+            int64_t aik = row[k];
+            for (int j = k + 1; j < n; j++)
+            {
+                __int128 t = (__int128)akk * row[j] - (__int128)aik * pivotRow[j];
+                __int128 q = t / prev;
+                if (q >= EXACT_SMALL_LIMIT || q <= -EXACT_SMALL_LIMIT)
+                {
+                    atomic_store(&job->overflow, 1);
+                    break;
+                }
+                row[j] = (int64_t)q;
+            }
+        }
+        pthread_barrier_wait(&job->sync);
+        if (atomic_load(&job->overflow))
+            return 0;
+        prev = akk;
+    }
+    return 1;
+}
+
+/* Multi-precision elimination from the original input */
+static void bareissBig(ExactJob *job, int tid)
+{
+    int n = job->n, p = job->threads, L = job->L, lo, hi;
+
+    if (tid == 0)
+    {
+        job->limb = malloc((size_t)n * n * L * sizeof(uint64_t));
+        job->len = malloc((size_t)n * n * sizeof(int));
+        job->sign = malloc((size_t)n * n);
+        job->pivotSign = 1;
+        job->singular = 0;
+    }
+    pthread_barrier_wait(&job->sync);
+
+    splitRange(0, n, p, tid, 1, &lo, &hi);
+    for (size_t e = (size_t)lo * n; e < (size_t)hi * n; e++)
+    {
+        int64_t v = job->src[e];
+        job->limb[e * L] = (v < 0) ? -(uint64_t)v : (uint64_t)v;
+        job->len[e] = (v != 0);
+        job->sign[e] = (v > 0) - (v < 0);
+    }
+
+    uint64_t *p1 = malloc((2 * L + 1) * sizeof(uint64_t));
+    uint64_t *p2 = malloc((2 * L + 1) * sizeof(uint64_t));
+    uint64_t *t = malloc((2 * L + 2) * sizeof(uint64_t));
+    uint64_t *q = malloc((2 * L + 2) * sizeof(uint64_t));
+    uint64_t *dv = malloc(L * sizeof(uint64_t));
+    pthread_barrier_wait(&job->sync);
+
+#define ENTRY(i, j) ((size_t)(i) * n + (j))
+    for (int k = 0; k < n; k++)
+    {
+        if (tid == 0)
+        {
+            int r = k;
+            while (r < n && job->len[ENTRY(r, k)] == 0)
+                r++;
+            if (r == n)
+            {
+                job->singular = 1;
+            }
+            else if (r != k)
+            {
+                for (int j = k; j < n; j++)
+                {
+                    size_t a = ENTRY(k, j), b = ENTRY(r, j);
+                    memcpy(t, job->limb + a * L, L * sizeof(uint64_t));
+                    memcpy(job->limb + a * L, job->limb + b * L, L * sizeof(uint64_t));
+                    memcpy(job->limb + b * L, t, L * sizeof(uint64_t));
+                    int tl = job->len[a]; job->len[a] = job->len[b]; job->len[b] = tl;
+                    signed char ts = job->sign[a]; job->sign[a] = job->sign[b]; job->sign[b] = ts;
+                }
+                job->pivotSign = -job->pivotSign;
+            }
+        }
+        pthread_barrier_wait(&job->sync);
+        if (job->singular || k == n - 1)
+            break;
+
+        /* Divisor of this step: the previous pivot with its factors of two split off */
+        int dl = 1, tz = 0, ds = 1;
+        dv[0] = 1;
+        if (k > 0)
+        {
+            size_t e = ENTRY(k - 1, k - 1);
+            dl = job->len[e];
+            ds = job->sign[e];
+            memcpy(dv, job->limb + e * L, dl * sizeof(uint64_t));
+            while (dv[tz / 64] == 0)
+                tz += 64;
+            tz += __builtin_ctzll(dv[tz / 64]);
+            dl = magShiftRight(dv, dl, tz);
+        }
+        uint64_t binv = limbInverse(dv[0]);
+
+        size_t kk = ENTRY(k, k);
+        splitRange(k + 1, n, p, tid, 1, &lo, &hi);
+        for (int i = lo; i < hi; i++)
+        {
+            size_t ik = ENTRY(i, k);
+            for (int j = k + 1; j < n; j++)
+            {
+                size_t ij = ENTRY(i, j), kj = ENTRY(k, j);
+                int l1 = magMul(p1, job->limb + kk * L, job->len[kk], job->limb + ij * L, job->len[ij]);
+                int l2 = magMul(p2, job->limb + ik * L, job->len[ik], job->limb + kj * L, job->len[kj]);
+                int ts;
+                int lt = bigSubSigned(t, &ts, p1, l1, job->sign[kk] * job->sign[ij],
+                                      p2, l2, job->sign[ik] * job->sign[kj]);
+                lt = magShiftRight(t, lt, tz);
+                int lq = magDivExact(q, t, lt, dv, dl, binv);
+
+                /* The Hadamard bound guarantees lq <= L */
+                memcpy(job->limb + ij * L, q, lq * sizeof(uint64_t));
+                job->len[ij] = lq;
+                job->sign[ij] = lq ? ts * ds : 0;
+            }
+        }
+        pthread_barrier_wait(&job->sync);
+    }
+#undef ENTRY
+
+    free(p1);
+    free(p2);
+    free(t);
+    free(q);
+    free(dv);
+}
+
+/*
+ * dst = A, or A with column col replaced by vec when col >= 0, rounded to integers.
+ * Returns log2 of its Hadamard bound Π max(1, ‖row i‖).
+ */
+static double loadIntMatrix(int64_t *dst, const Grid *A, const double *vec, int col)
+{
+    int n = A->n;
+    double bits = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double norm2 = 0;
+        for (int j = 0; j < n; j++)
+        {
+            double v = (j == col) ? vec[i] : GRID_ROW(A, i)[j];
+            dst[(size_t)i * n + j] = llround(v);
+            norm2 += v * v;
+        }
+        if (norm2 > 1)
+            bits += 0.5 * log2(norm2);
+    }
+    return bits;
+}
+
+static void exactTask(void *arg, int tid, int nthreads)
+{
+    ExactJob *job = arg;
+    (void)nthreads;
+
+    if (tid >= job->threads)
+        return;
+    if (!bareissSmall(job, tid))
+        bareissBig(job, tid);
+}
+
+/* Exact det(A), or of A with column col replaced by vec when col >= 0 */
+BigInt calcExactDet(const Grid *A, const double *vec, int col)
+{
+    int n = A->n;
+    BigInt det = { 1, 1, malloc(sizeof(uint64_t)) };
+    ExactJob job;
+
+    det.limb[0] = 1;
+    if (n == 0)
+        return det;
+
+    memset(&job, 0, sizeof(job));
+    job.n = n;
+    int64_t *src = malloc((size_t)n * n * sizeof(int64_t));
+    double bits = loadIntMatrix(src, A, vec, col);
+    job.src = src;
+    job.small = malloc((size_t)n * n * sizeof(int64_t));
+    memcpy(job.small, src, (size_t)n * n * sizeof(int64_t));
+    job.L = (int)(bits / 64) + 2;
+    job.pivotSign = 1;
+    atomic_init(&job.overflow, 0);
+
+    int threads = (detThreads > 0) ? detThreads : poolSize(1 << 30);
+    if (threads > 1 && n >= EXACT_PAR_MIN_DIM && !insideTeam)
+    {
+        ThreadTeam *t = sharedTeam();
+        job.threads = (threads < t->size) ? threads : t->size;
+        pthread_barrier_init(&job.sync, NULL, job.threads);
+        teamRun(t, exactTask, &job);
+    }
+    else
+    {
+        job.threads = 1;
+        pthread_barrier_init(&job.sync, NULL, 1);
+        exactTask(&job, 0, 1);
+    }
+    pthread_barrier_destroy(&job.sync);
+
+    size_t last = (size_t)n * n - 1;
+    if (job.singular)
+    {
+        det.sign = 0;
+        det.len = 0;
+    }
+    else if (!job.limb)
+    {
+        int64_t v = job.small[last];
+        det.limb[0] = (v < 0) ? -(uint64_t)v : (uint64_t)v;
+        det.sign = job.pivotSign * ((v > 0) - (v < 0));
+    }
+    else
+    {
+        det.len = job.len[last];
+        det.sign = job.pivotSign * job.sign[last];
+        det.limb = realloc(det.limb, (det.len ? det.len : 1) * sizeof(uint64_t));
+        memcpy(det.limb, job.limb + last * job.L, det.len * sizeof(uint64_t));
+    }
+    if (det.sign == 0)
+        det.len = 0;
+
+    free(src);
+    free(job.small);
+    free(job.limb);
+    free(job.len);
+    free(job.sign);
+    return det;
+}
+
+/*****************************************************************************************
+ * MULTI-MODULAR DETERMINANT
+ *
+ * Bareiss keeps every intermediate as a growing multi-precision integer. The
+ * modular engine instead computes det mod p for many 62-bit primes p, each with
+ * plain Gaussian elimination in word-sized arithmetic, and rebuilds the integer
+ * by the Chinese Remainder Theorem:
+ *      1. Hadamard bound H = Π max(1, ‖row i‖) ≥ |det|
+ *      2. Take primes p₀, p₁, … until p₀ · p₁ ⋯ > 2H (primes below 2⁶², found once
+ *         by Miller–Rabin and kept in a table)
+ *      3. det mod pᵢ for every prime: O(n³) each, fully independent
+ *      4. Garner's algorithm → mixed-radix digits → the integer in (−M/2, M/2]
+ * Residues are kept in Montgomery form (R = 2⁶⁴), so a modular product is two
+ * 64 × 64 → 128-bit multiplies and no division.
+ *
+ * Every (matrix, prime) pair is a separate job of equal cost, which is what the
+ * pools hand out in SOLVE_MODULAR mode (see columnWorker / columnTask).
+ *****************************************************************************************/
+
+#define MOD_PRIME_TOP ((1ULL << 62) - 1)   /* Primes are searched downwards from here */
+
+typedef struct
+{
+    uint64_t p;
+    uint64_t pinv;     /* −p⁻¹ mod 2⁶⁴ */
+    uint64_t r2;       /* R² mod p, to enter Montgomery form */
+    uint64_t crt;      /* (p₀ ⋯ pᵢ₋₁)⁻¹ mod pᵢ for Garner's algorithm */
+    double bits;       /* log2(p₀ ⋯ pᵢ) */
+} ModPrime;
+
+static ModPrime *modPrimes = NULL;
+static int modPrimeCount = 0;
+static pthread_mutex_t modPrimeLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t mulMod(uint64_t a, uint64_t b, uint64_t p)
+{
+    return (uint64_t)((unsigned __int128)a * b % p);
+}
+
+static uint64_t powMod(uint64_t a, uint64_t e, uint64_t p)
+{
+    uint64_t r = 1;
+    for (; e; e >>= 1, a = mulMod(a, a, p))
+        if (e & 1)
+            r = mulMod(r, a, p);
+    return r;
+}
+
+/* Deterministic Miller–Rabin: these bases decide every n < 3.3 · 10²⁴ */
+static int isPrime64(uint64_t n)
+{
+    static const uint64_t bases[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+    uint64_t d = n - 1;
+    int s = 0;
+
+    if (n < 2 || n % 2 == 0)
+        return n == 2;
+    while (d % 2 == 0)
+    {
+        d /= 2;
+        s++;
+    }
+    for (int i = 0; i < 12; i++)
+    {
+        uint64_t x = powMod(bases[i] % n, d, n);
+        if (x == 0 || x == 1 || x == n - 1)
+            continue;
+        int r = 1;
+        for (; r < s; r++)
+        {
+            x = mulMod(x, x, n);
+            if (x == n - 1)
+                break;
+        }
+        if (r == s)
+            return 0;
+    }
+    return 1;
+}
+
+/* Grow the prime table until the product of its primes exceeds 2^bits; returns the count */
+static int modPrimesFor(double bits)
+{
+    int k;
+
+    pthread_mutex_lock(&modPrimeLock);
+    while (modPrimeCount == 0 || modPrimes[modPrimeCount - 1].bits <= bits)
+    {
+        int i = modPrimeCount;
+        uint64_t p = (i == 0) ? MOD_PRIME_TOP : modPrimes[i - 1].p - 2;
+        while (!isPrime64(p))
+            p -= 2;
+
+        modPrimes = realloc(modPrimes, (i + 1) * sizeof(ModPrime));
+        ModPrime *m = &modPrimes[i];
+        uint64_t r = (uint64_t)(((unsigned __int128)1 << 64) % p);
+        uint64_t prod = 1;
+        for (int j = 0; j < i; j++)
+            prod = mulMod(prod, modPrimes[j].p % p, p);
+
+        m->p = p;
+        m->pinv = -limbInverse(p);
+        m->r2 = mulMod(r, r, p);
+        m->crt = powMod(prod, p - 2, p);
+        m->bits = ((i == 0) ? 0 : modPrimes[i - 1].bits) + log2((double)p);
+        modPrimeCount = i + 1;
+    }
+    for (k = 1; modPrimes[k - 1].bits <= bits; k++)
+        ;
+    pthread_mutex_unlock(&modPrimeLock);
+    return k;
+}
+
+/* a · b · R⁻¹ mod p for a, b < p */
+static inline uint64_t montMul(uint64_t a, uint64_t b, const ModPrime *m)
+{
+    unsigned __int128 t = (unsigned __int128)a * b;
+    uint64_t q = (uint64_t)t * m->pinv;
+    uint64_t r = (uint64_t)((t + (unsigned __int128)q * m->p) >> 64);
+    return (r >= m->p) ? r - m->p : r;
+}
+
+static uint64_t montPow(uint64_t a, uint64_t e, const ModPrime *m)
+{
+    uint64_t r = montMul(1, m->r2, m);   // R mod p, i.e. 1 in Montgomery form
+    for (; e; e >>= 1, a = montMul(a, a, m))
+        if (e & 1)
+            r = montMul(r, a, m);
+    return r;
+}
+
+/* det(M) mod p for an n × n integer matrix; w is n² words of scratch */
+uint64_t detModPrime(const int64_t *src, int n, const ModPrime *m, uint64_t *w)
+{
+    uint64_t p = m->p;
+    size_t nn = (size_t)n * n;
+
+    for (size_t e = 0; e < nn; e++)
+    {
+        int64_t v = src[e];
+        uint64_t r = (v < 0) ? (p - (uint64_t)(-v) % p) % p : (uint64_t)v % p;
+        w[e] = montMul(r, m->r2, m);
+    }
+
+    uint64_t det = montMul(1, m->r2, m);
+    for (int k = 0; k < n; k++)
+    {
+        uint64_t *pivotRow = w + (size_t)k * n;
+        int r = k;
+        while (r < n && w[(size_t)r * n + k] == 0)
+            r++;
+        if (r == n)
+            return 0;
+        if (r != k)
+        {
+            uint64_t *other = w + (size_t)r * n;
+            for (int j = k; j < n; j++)
+            {
+                uint64_t t = pivotRow[j];
+                pivotRow[j] = other[j];
+                other[j] = t;
+            }
+            det = det ? p - det : 0;
+        }
+        det = montMul(det, pivotRow[k], m);
+
+        uint64_t inv = montPow(pivotRow[k], p - 2, m);
+        for (int i = k + 1; i < n; i++)
+        {
+            uint64_t *row = w + (size_t)i * n;
+            uint64_t f = montMul(row[k], inv, m);
+            if (f == 0)
+                continue;
+            for (int j = k + 1; j < n; j++)
+            {
+                uint64_t s = montMul(f, pivotRow[j], m);
+                row[j] = (row[j] >= s) ? row[j] - s : row[j] + (p - s);
+            }
+        }
+    }
+    return montMul(det, 1, m);
+}
+
+/* a = a · m + add in place (a has room for one more limb); returns the new length */
+static int magMulAddLimb(uint64_t *a, int la, uint64_t m, uint64_t add)
+{
+    unsigned __int128 carry = add;
+    for (int i = 0; i < la; i++)
+    {
+        carry += (unsigned __int128)a[i] * m;
+        a[i] = (uint64_t)carry;
+        carry >>= 64;
+    }
+    if (carry)
+        a[la++] = (uint64_t)carry;
+    return la;
+}
+
+/* The integer in (−M/2, M/2] with the given residues modulo the first k primes */
+BigInt crtReconstruct(const uint64_t *res, int k)
+{
+    uint64_t *digit = malloc(k * sizeof(uint64_t));
+    uint64_t *x = calloc(k + 1, sizeof(uint64_t));
+    uint64_t *M = calloc(k + 1, sizeof(uint64_t));
+    uint64_t *y = calloc(k + 1, sizeof(uint64_t));
+    BigInt det;
+
+    /* Garner: digit i makes the mixed-radix value right modulo pᵢ */
+    for (int i = 0; i < k; i++)
+    {
+        uint64_t p = modPrimes[i].p, v = 0;
+        for (int j = i - 1; j >= 0; j--)
+            v = (mulMod(v, modPrimes[j].p % p, p) + digit[j] % p) % p;
+        digit[i] = mulMod((res[i] + p - v) % p, modPrimes[i].crt, p);
+    }
+
+    /* x = d₀ + p₀ · (d₁ + p₁ · (d₂ + …)), M = p₀ · p₁ ⋯ */
+    int lx = 0, lm = 1;
+    M[0] = 1;
+    for (int i = k - 1; i >= 0; i--)
+    {
+        lx = magMulAddLimb(x, lx, modPrimes[i].p, digit[i]);
+        lm = magMulAddLimb(M, lm, modPrimes[i].p, 0);
+    }
+
+    /* Above M/2 stands for the negative value x − M */
+    int ly = magSub(y, M, lm, x, lx);
+    det.sign = lx ? 1 : 0;
+    if (magCmp(x, lx, y, ly) > 0)
+    {
+        uint64_t *t = x; x = y; y = t;
+        lx = ly;
+        det.sign = -1;
+    }
+    det.limb = x;
+    det.len = lx;
+
+    free(digit);
+    free(M);
+    free(y);
+    return det;
+}
+
+/* Primes needed for any det(Ai): Hadamard bound of the rows of [A | B] */
+static int modularPrimes(const Grid *A, const double *B)
+{
+    double bits = 0;
+    for (int i = 0; i < A->n; i++)
+    {
+        double norm2 = B[i] * B[i];
+        for (int j = 0; j < A->n; j++)
+            norm2 += GRID_ROW(A, i)[j] * GRID_ROW(A, i)[j];
+        if (norm2 > 1)
+            bits += 0.5 * log2(norm2);
+    }
+    return modPrimesFor(bits + 1);
+}
+
+/* det(A) (col < 0) or det(A with column col = vec) modulo prime number q */
+uint64_t detModular(const Grid *A, const double *vec, int col, int q)
+{
+    int n = A->n;
+    int64_t *src = malloc(((size_t)n * n + 1) * sizeof(int64_t));
+    uint64_t *w = malloc(((size_t)n * n + 1) * sizeof(uint64_t));
+
+    loadIntMatrix(src, A, vec, col);
+    uint64_t r = detModPrime(src, n, &modPrimes[q], w);
+    free(src);
+    free(w);
+    return r;
+}
+
+/* Exact det(A) (col < 0) or det(A with column col = vec), one prime after another */
+BigInt calcModularDet(const Grid *A, const double *vec, int col)
+{
+    int n = A->n;
+    int64_t *src = malloc(((size_t)n * n + 1) * sizeof(int64_t));
+    uint64_t *w = malloc(((size_t)n * n + 1) * sizeof(uint64_t));
+
+    int k = modPrimesFor(loadIntMatrix(src, A, vec, col) + 1);
+    uint64_t *res = malloc(k * sizeof(uint64_t));
+    for (int q = 0; q < k; q++)
+        res[q] = detModPrime(src, n, &modPrimes[q], w);
+
+    BigInt det = crtReconstruct(res, k);
+    free(res);
+    free(src);
+    free(w);
+    return det;
+}
+
+/*****************************************************************************************
+ * SINGLE-FACTORIZATION SOLVER
+ *
+ * Cramer's Rule recomputes an O(n³) elimination for each of the n column-replaced
+ * matrices. Since det(Ai) = det(A) · Xi, one LU factorization of A is enough:
+ *      1. Factor A = L · U once                       O(n³)
+ *      2. Solve L · y = B, then U · X = y             O(n²)
+ *      3. det(Ai) = det(A) · Xi (only if requested)   O(n)
+ * The results match the Cramer solvers (solution vector plus per-variable
+ * determinants) at the cost of a single determinant. The factorization carries
+ * the pivot exchanges (P · A · Q = L · U), which the solves apply to b and x.
+ *****************************************************************************************/
+
+#define SOLVE_CRAMER 0
+#define SOLVE_LU     1
+#define SOLVE_RANK1  2   /* Cramer loop, but det(Ai) via rank-one updates of A's LU */
+#define SOLVE_EXACT  3   /* Cramer loop with exact integer determinants (Bareiss) */
+#define SOLVE_MODULAR 4  /* Exact determinants from residues modulo many primes (CRT) */
+#define SOLVE_MIXED   5  /* Float LU plus iterative refinement in double (linearSolveMixed) */
+
+static int solveMode = SOLVE_CRAMER;   /* Selected with -m cramer|lu|rank1|exact|modular|mixed */
+
+typedef struct
+{
+    Grid *lu;       /* Unit L below the diagonal, U on and above it */
+    LogDet det;     /* det(A); sign 0 means the factorization broke down */
+    int *ipiv;      /* Row exchanges, see luFactor */
+    int *cpiv;      /* Column exchanges (identity unless complete/rook pivoting) */
+    BigInt exact;   /* det(A) as an integer in SOLVE_EXACT / SOLVE_MODULAR mode (no factors then) */
+    double *rank1;  /* A⁻¹·B in SOLVE_RANK1 mode once luSolveRank1 ran, else NULL */
+} LUFactor;
+
+/* LU of a copy of A in `work` (which must be n × n), whatever the solve mode */
+LUFactor luFactorCopy(const Grid *A, Grid *work)
+{
+    LUFactor f;
+    int n = A->n ? A->n : 1;
+    cloneGrid(A, work);
+    f.lu = work;
+    f.exact = (BigInt){ 0, 0, NULL };
+    f.rank1 = NULL;
+    f.ipiv = malloc(n * sizeof(int));
+    f.cpiv = malloc(n * sizeof(int));
+    f.det = luFactor(work, luBlock, f.ipiv, f.cpiv);
+    return f;
+}
+
+/* Factor a copy of A into `work` (which must be n × n); free with luRelease */
+LUFactor luDecompose(const Grid *A, Grid *work)
+{
+    /* The exact Cramer loop only needs det(A); it never solves with the factors */
+    if (solveMode == SOLVE_EXACT || solveMode == SOLVE_MODULAR)
+    {
+        LUFactor f = { work, LOGDET_ZERO, NULL, NULL, { 0, 0, NULL }, NULL };
+        cloneGrid(A, work);
+        f.exact = (solveMode == SOLVE_MODULAR) ? calcModularDet(A, NULL, -1)
+                                               : calcExactDet(A, NULL, -1);
+        f.det = bigToLogDet(&f.exact);
+        return f;
+    }
+
+    return luFactorCopy(A, work);
+}
+
+void luRelease(LUFactor *f)
+{
+    free(f->ipiv);
+    free(f->cpiv);
+    free(f->rank1);
+    f->ipiv = f->cpiv = NULL;
+    f->rank1 = NULL;
+    bigFree(&f->exact);
+}
+
+/* Apply the exchanges perm[0 .. n) to v, forwards or in reverse order */
+static void applySwaps(double *v, const int *perm, int n, int reverse)
+{
+    for (int s = 0; s < n; s++)
+    {
+        int i = reverse ? n - 1 - s : s;
+        double t = v[i];
+        v[i] = v[perm[i]];
+        v[perm[i]] = t;
+    }
+}
+
+/* Solve A · x = b with an existing factorization (b and x may alias) */
+void luSolve(const LUFactor *f, const double *b, double *x)
+{
+    const Grid *g = f->lu;
+    int n = g->n;
+
+    if (x != b)
+        memcpy(x, b, n * sizeof(double));
+    applySwaps(x, f->ipiv, n, 0);   // P · b
+
+    /* Forward substitution with the unit lower triangle */
+    for (int i = 0; i < n; i++)
+    {
+        const double *row = GRID_ROW(g, i);
+        double sum = x[i];
+        for (int k = 0; k < i; k++)
+            sum -= row[k] * x[k];
+        x[i] = sum;
+    }
+
+    /* Back substitution with the upper triangle */
+    for (int i = n - 1; i >= 0; i--)
+    {
+        const double *row = GRID_ROW(g, i);
+        double sum = x[i];
+        for (int k = i + 1; k < n; k++)
+            sum -= row[k] * x[k];
+        x[i] = sum / row[i];
+    }
+
+    applySwaps(x, f->cpiv, n, 1);   // x = Q · y
+}
+
+/* Solve Aᵀ · x = b with an existing factorization (b and x may alias) */
+void luSolveTrans(const LUFactor *f, const double *b, double *x)
+{
+    const Grid *g = f->lu;
+    int n = g->n;
+
+    if (x != b)
+        memcpy(x, b, n * sizeof(double));
+    applySwaps(x, f->cpiv, n, 0);   // Qᵀ · b
+
+    /* Uᵀ · z = b, eliminating row by row so U is read contiguously */
+    for (int i = 0; i < n; i++)
+    {
+        const double *row = GRID_ROW(g, i);
+        x[i] /= row[i];
+        for (int k = i + 1; k < n; k++)
+            x[k] -= row[k] * x[i];
+    }
+
+    /* Lᵀ · x = z with the unit lower triangle */
+    for (int i = n - 1; i > 0; i--)
+    {
+        const double *row = GRID_ROW(g, i);
+        for (int k = 0; k < i; k++)
+            x[k] -= row[k] * x[i];
+    }
+
+    applySwaps(x, f->ipiv, n, 1);   // x = Pᵀ · z
+}
+
+/*****************************************************************************************
+ * RANK-ONE DETERMINANT UPDATES
+ *
+ * Replacing column i of A by v is the rank-one change A + (v − A·eᵢ)·eᵢᵀ. By the
+ * matrix determinant lemma
+ *      det(A with column i = v) = det(A) · (1 + eᵢᵀ·A⁻¹·(v − A·eᵢ)) = det(A) · (A⁻¹·v)ᵢ
+ * so an existing LU of A gives the new determinant with one O(n²) solve instead of
+ * a fresh O(n³) elimination. Replacing row i works the same way with Aᵀ.
+ * When every column is replaced by the same vector, one solve serves all of them.
+ *****************************************************************************************/
+
+/* det(A with column col replaced by vec) in O(n²), as (sign, log|det|) */
+LogDet logDetColumnReplaced(const LUFactor *f, const double *vec, int col)
+{
+    if (f->det.sign == 0)
+        return LOGDET_ZERO;
+
+    double *y = malloc(f->lu->n * sizeof(double));
+    luSolve(f, vec, y);
+    LogDet det = logDetScale(f->det, y[col]);
+    free(y);
+    return det;
+}
+
+/* det(A with column col replaced by vec) in O(n²) */
+double detColumnReplaced(const LUFactor *f, const double *vec, int col)
+{
+    return logDetValue(logDetColumnReplaced(f, vec, col));
+}
+
+/* det(A with row row replaced by vec) in O(n²) */
+double detRowReplaced(const LUFactor *f, const double *vec, int row)
+{
+    if (f->det.sign == 0)
+        return 0;
+
+    double *y = malloc(f->lu->n * sizeof(double));
+    luSolveTrans(f, vec, y);
+    double det = logDetValue(logDetScale(f->det, y[row]));
+    free(y);
+    return det;
+}
+
+/* D[i] = det(A with column i replaced by vec) for every i: one solve, then O(1) each */
+void detColumnReplacedAll(const LUFactor *f, const double *vec, double *D)
+{
+    int n = f->lu->n;
+    if (f->det.sign == 0)
+    {
+        memset(D, 0, n * sizeof(double));
+        return;
+    }
+
+    luSolve(f, vec, D);
+    for (int i = 0; i < n; i++)
+        D[i] = logDetValue(logDetScale(f->det, D[i]));
+}
+
+/*
+ * SOLVE_RANK1 Cramer loop: keep A⁻¹·B with the factors, so every det(Ai) in
+ * columnSolve is det(A) · rank1[i] and the loop costs one solve, not one per
+ * column. Called once per solve, before any worker starts.
+ */
+static void luSolveRank1(LUFactor *f, const double *B)
+{
+    if (solveMode != SOLVE_RANK1 || f->det.sign == 0)
+        return;
+
+    f->rank1 = malloc(f->lu->n * sizeof(double));
+    luSolve(f, B, f->rank1);
+}
+
+/* Solve AX = B from one factorization; D (optional) receives det(Ai) for each i */
+void linearSolveLU(const Grid *A, double *B, double *X, double *D, int n, ScratchArena *ar)
+{
+    ScratchArena local;
+    if (!ar)
+    {
+        arenaInit(&local);
+        ar = &local;
+    }
+
+    LUFactor f = luDecompose(A, arenaGrid(ar, 0, n));
+
+    if (f.det.sign != 0)  // Otherwise no unique solution
+    {
+        luSolve(&f, B, X);
+        if (D)
+            detColumnReplacedAll(&f, B, D);
+    }
+
+    luRelease(&f);
+    if (ar == &local)
+        arenaRelease(&local);
+}
+
+/*
+ * Xi and, if d is given, det(Ai) for the Cramer loop. det(Ai) comes from a fresh
+ * elimination in `work`, a rank-one update of A's LU, or an exact integer
+ * elimination or residue set, depending on the mode.
+ */
+static void columnSolve(const Grid *A, const LUFactor *f, const double *B, int i, Grid *work,
+                        double *x, double *d)
+{
+    LogDet detVar;
+
+    if (solveMode == SOLVE_EXACT || solveMode == SOLVE_MODULAR)
+    {
+        BigInt exact = (solveMode == SOLVE_MODULAR) ? calcModularDet(A, B, i)
+                                                    : calcExactDet(A, B, i);
+        *x = bigRatio(&exact, &f->exact);
+        if (d)
+            *d = bigToDouble(&exact);
+        bigFree(&exact);
+        return;
+    }
+
+    if (solveMode == SOLVE_RANK1)
+    {
+        detVar = logDetScale(f->det, f->rank1[i]);
+    }
+    else
+    {
+        detVar = calcLogDetReplaced(A, B, i, work);
+    }
+    *x = logDetRatio(detVar, f->det);
+    if (d)
+        *d = logDetValue(detVar);
+}
+
+/* SOLVE_MODULAR pools: Xi and det(Ai) from the residues [i · primes, (i + 1) · primes) */
+static void modularColumn(const LUFactor *f, const uint64_t *residue, int primes, int i,
+                          double *x, double *d)
+{
+    BigInt det = crtReconstruct(residue + (size_t)i * primes, primes);
+    *x = bigRatio(&det, &f->exact);
+    if (d)
+        *d = bigToDouble(&det);
+    bigFree(&det);
+}
+
+/*****************************************************************************************
+ * MULTIPLE RIGHT-HAND SIDES
+ *
+ * A · X = B for an n × k block B (row-major, leading dimension k). A is factored
+ * once and the k columns are solved together: the triangular solves are blocked
+ * like the LU itself (TRSM), so all but an nb × nb diagonal block of each sweep is
+ * one kern.gemm call over all k columns and every row of L and U is read once per
+ * block instead of once per right-hand side.
+ *
+ * A SolveStream keeps the factorization between calls for right-hand sides that
+ * arrive one at a time; they are queued and solved STREAM_BLOCK at a time.
+ *****************************************************************************************/
+
+#define STREAM_BLOCK 32   /* Right-hand sides gathered per blocked solve */
+
+/* Apply the row exchanges perm[0 .. n) to the rows (k wide) of X */
+static void applyRowSwaps(double *X, int k, const int *perm, int n, int reverse)
+{
+    for (int s = 0; s < n; s++)
+    {
+        int i = reverse ? n - 1 - s : s;
+        if (perm[i] != i)
+            for (int c = 0; c < k; c++)
+            {
+                double t = X[(size_t)i * k + c];
+                X[(size_t)i * k + c] = X[(size_t)perm[i] * k + c];
+                X[(size_t)perm[i] * k + c] = t;
+            }
+    }
+}
+
+/* Solve A · X = B (n × k, B and X may alias) with an existing factorization */
+void luSolveMulti(const LUFactor *f, const double *B, double *X, int k)
+{
+    const Grid *g = f->lu;
+    int n = g->n, nb = luBlock;
+
+    if (X != B)
+        memcpy(X, B, (size_t)n * k * sizeof(double));
+    applyRowSwaps(X, k, f->ipiv, n, 0);   // P · B
+
+    /* L · Y = P · B: rows left of the block come in through one GEMM */
+    for (int i0 = 0; i0 < n; i0 += nb)
+    {
+        int i1 = (i0 + nb < n) ? i0 + nb : n;
+        if (i0 > 0)
+            kern.gemm(X + (size_t)i0 * k, k, GRID_ROW(g, i0), g->ld, X, k, i1 - i0, k, i0);
+        for (int i = i0 + 1; i < i1; i++)
+            for (int j = i0; j < i; j++)
+                kern.axpy(X + (size_t)i * k, X + (size_t)j * k, GRID_ROW(g, i)[j], k);
+    }
+
+    /* U · Z = Y from the bottom block up */
+    for (int i0 = (n - 1) / nb * nb; i0 >= 0; i0 -= nb)
+    {
+        int i1 = (i0 + nb < n) ? i0 + nb : n;
+        if (i1 < n)
+            kern.gemm(X + (size_t)i0 * k, k, GRID_ROW(g, i0) + i1, g->ld, X + (size_t)i1 * k, k,
+                      i1 - i0, k, n - i1);
+        for (int i = i1 - 1; i >= i0; i--)
+        {
+            const double *row = GRID_ROW(g, i);
+            double *xi = X + (size_t)i * k;
+            for (int j = i + 1; j < i1; j++)
+                kern.axpy(xi, X + (size_t)j * k, row[j], k);
+            for (int c = 0; c < k; c++)
+                xi[c] /= row[i];
+        }
+    }
+
+    applyRowSwaps(X, k, f->cpiv, n, 1);   // X = Q · Z
+}
+
+/* Solve A · X = B for the k columns of B (n × k, row-major) with one factorization */
+void linearSolveMulti(const Grid *A, const double *B, double *X, int n, int k, ScratchArena *ar)
+{
+    ScratchArena local;
+    if (!ar)
+    {
+        arenaInit(&local);
+        ar = &local;
+    }
+
+    LUFactor f = luFactorCopy(A, arenaGrid(ar, 0, n));
+
+    if (f.det.sign != 0)  // Otherwise no unique solution
+        luSolveMulti(&f, B, X, k);
+
+    luRelease(&f);
+    if (ar == &local)
+        arenaRelease(&local);
+}
+
+typedef struct
+{
+    Grid lu;          /* Owned copy of the factors; lives until solveStreamClose */
+    LUFactor f;
+    int pending;      /* Right-hand sides queued in B */
+    double *B;        /* n × STREAM_BLOCK, one queued right-hand side per column */
+    double *dest[STREAM_BLOCK];
+} SolveStream;
+
+/* Factor A for a stream of right-hand sides; returns det(A) (sign 0: singular) */
+LogDet solveStreamOpen(SolveStream *st, const Grid *A)
+{
+    st->lu = makeGrid(A->n);
+    st->f = luFactorCopy(A, &st->lu);
+    st->pending = 0;
+    st->B = malloc((size_t)A->n * STREAM_BLOCK * sizeof(double));
+    return st->f.det;
+}
+
+/* Solve the queued right-hand sides and write each solution to its destination */
+void solveStreamFlush(SolveStream *st)
+{
+    int n = st->lu.n, w = st->pending;
+    if (w == 0)
+        return;
+    st->pending = 0;
+    if (st->f.det.sign == 0)
+        return;
+
+    /* Pack the queue to width w so the solve does not sweep empty columns */
+    if (w < STREAM_BLOCK)
+        for (int i = 1; i < n; i++)
+            memmove(st->B + (size_t)i * w, st->B + (size_t)i * STREAM_BLOCK, w * sizeof(double));
+
+    luSolveMulti(&st->f, st->B, st->B, w);
+    for (int c = 0; c < w; c++)
+        for (int i = 0; i < n; i++)
+            st->dest[c][i] = st->B[(size_t)i * w + c];
+}
+
+/*
+ * Queue A · x = b. x is written by the time the queue fills up or is flushed
+ * (solveStreamFlush / solveStreamClose); b can be reused at once.
+ */
+void solveStreamPush(SolveStream *st, const double *b, double *x)
+{
+    int n = st->lu.n, c = st->pending;
+
+    for (int i = 0; i < n; i++)
+        st->B[(size_t)i * STREAM_BLOCK + c] = b[i];
+    st->dest[c] = x;
+    if (++st->pending == STREAM_BLOCK)
+        solveStreamFlush(st);
+}
+
+void solveStreamClose(SolveStream *st)
+{
+    solveStreamFlush(st);
+    luRelease(&st->f);
+    destroyGrid(&st->lu);
+    free(st->B);
+    st->B = NULL;
+}
+
+/*****************************************************************************************
+ * MIXED-PRECISION SOLVER
+ *
+ * -m mixed factors A in float, where every kernel moves twice as many entries per
+ * instruction and half as many bytes, and recovers double accuracy by iterative
+ * refinement:
+ *      x = 0, r = B
+ *      repeat: solve L · U · d = P · r in float;  x += d;  r = B − A · x in double
+ * until the backward error ‖r‖ / (‖A‖ · ‖x‖ + ‖B‖) (∞-norms) is below √n · ε. If
+ * the float factorization breaks down, the error stops halving or MIXED_MAX_ITER
+ * corrections are spent, the system is solved again by the double LU. lastRefine
+ * records the outcome for the CSV. The float LU always pivots by rows (unless -P
+ * none); a fallback uses the selected pivoting.
+ *****************************************************************************************/
+
+#define MIXED_MAX_ITER 30
+
+typedef struct
+{
+    int iters;         /* Corrections after the first float solve; −1 if it fell back to double */
+    double residual;   /* Final backward error */
+} RefineStats;
+
+static RefineStats lastRefine;
+
+/* ‖A‖∞ */
+static double gridNormInf(const Grid *A)
+{
+    double norm = 0;
+    for (int i = 0; i < A->n; i++)
+    {
+        double sum = 0;
+        for (int j = 0; j < A->n; j++)
+            sum += fabs(GRID_ROW(A, i)[j]);
+        norm = (sum > norm) ? sum : norm;
+    }
+    return norm;
+}
+
+static double vecNormInf(const double *v, int n)
+{
+    double norm = 0;
+    for (int i = 0; i < n; i++)
+        norm = (fabs(v[i]) > norm) ? fabs(v[i]) : norm;
+    return norm;
+}
+
+/* r = B − A · X in double; returns ‖r‖∞ */
+static double residualInto(const Grid *A, const double *B, const double *X, double *r, int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        const double *row = GRID_ROW(A, i);
+        double sum = B[i];
+        for (int j = 0; j < n; j++)
+            sum -= row[j] * X[j];
+        r[i] = sum;
+    }
+    return vecNormInf(r, n);
+}
+
+/* Backward error ‖B − A · X‖ / (‖A‖ · ‖X‖ + ‖B‖) of a computed solution */
+double relResidual(const Grid *A, const double *B, const double *X, int n)
+{
+    double *r = malloc((n ? n : 1) * sizeof(double));
+    double rn = residualInto(A, B, X, r, n);
+    double scale = gridNormInf(A) * vecNormInf(X, n) + vecNormInf(B, n);
+    free(r);
+    return (scale > 0) ? rn / scale : rn;
+}
+
+/* Blocked LU with row pivoting of the n × n float matrix a (row stride ld); 0 if singular */
+static int luFactorFloat(float *a, int ld, int n, int nb, int *ipiv)
+{
+    for (int k0 = 0; k0 < n; k0 += nb)
+    {
+        int c0 = (k0 + nb < n) ? k0 + nb : n;
+
+        for (int i = k0; i < c0; i++)
+        {
+            int p = i;
+            if (pivotMode != PIVOT_NONE)
+                for (int r = i + 1; r < n; r++)
+                    if (fabsf(a[(size_t)r * ld + i]) > fabsf(a[(size_t)p * ld + i]))
+                        p = r;
+            ipiv[i] = p;
+            if (fabsf(a[(size_t)p * ld + i]) < 1e-9f)
+                return 0;
+
+            /* Whole rows, so L to the left and the trailing columns follow at once */
+            if (p != i)
+                for (int j = 0; j < n; j++)
+                {
+                    float t = a[(size_t)i * ld + j];
+                    a[(size_t)i * ld + j] = a[(size_t)p * ld + j];
+                    a[(size_t)p * ld + j] = t;
+                }
+
+            const float *pivotRow = a + (size_t)i * ld;
+            for (int j = i + 1; j < n; j++)
+            {
+                float *row = a + (size_t)j * ld;
+                float f = row[i] / pivotRow[i];
+                row[i] = f;
+                kern.axpyf(row + i + 1, pivotRow + i + 1, f, c0 - i - 1);
+            }
+        }
+
+        if (c0 < n)
+        {
+            /* U12 = L11⁻¹ · A12, then A22 −= L21 · U12 */
+            for (int i = k0 + 1; i < c0; i++)
+                for (int r = k0; r < i; r++)
+                    kern.axpyf(a + (size_t)i * ld + c0, a + (size_t)r * ld + c0,
+                               a[(size_t)i * ld + r], n - c0);
+            kern.gemmf(a + (size_t)c0 * ld + c0, ld, a + (size_t)c0 * ld + k0, ld,
+                       a + (size_t)k0 * ld + c0, ld, n - c0, n - c0, c0 - k0);
+        }
+    }
+    return 1;
+}
+
+/* d = A⁻¹ · r with the float factors; the substitutions accumulate in double */
+static void luSolveFloat(const float *a, int ld, int n, const int *ipiv, const double *r, double *d)
+{
+    memcpy(d, r, n * sizeof(double));
+    for (int i = 0; i < n; i++)
+    {
+        double t = d[i];
+        d[i] = d[ipiv[i]];
+        d[ipiv[i]] = t;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        const float *row = a + (size_t)i * ld;
+        double sum = d[i];
+        for (int k = 0; k < i; k++)
+            sum -= row[k] * d[k];
+        d[i] = sum;
+    }
+    for (int i = n - 1; i >= 0; i--)
+    {
+        const float *row = a + (size_t)i * ld;
+        double sum = d[i];
+        for (int k = i + 1; k < n; k++)
+            sum -= row[k] * d[k];
+        d[i] = sum / row[i];
+    }
+}
+
+void linearSolveMixed(const Grid *A, double *B, double *X, double *D, int n, ScratchArena *ar)
+{
+    ScratchArena local;
+    if (!ar)
+    {
+        arenaInit(&local);
+        ar = &local;
+    }
+
+    /* The float factors live in the first half of a double scratch grid, same stride */
+    Grid *work = arenaGrid(ar, 1, n);
+    float *lu = (float *)work->data;
+    int ld = work->ld;
+    int *ipiv = malloc((n ? n : 1) * sizeof(int));
+    double *r = malloc((n ? n : 1) * sizeof(double));
+    double *d = malloc((n ? n : 1) * sizeof(double));
+
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            lu[(size_t)i * ld + j] = (float)GRID_ROW(A, i)[j];
+
+    double anorm = gridNormInf(A), bnorm = vecNormInf(B, n);
+    double tol = sqrt((double)n) * DBL_EPSILON, err = INFINITY;
+    int ok = luFactorFloat(lu, ld, n, luBlock, ipiv), it = 0;
+
+    if (ok)
+    {
+        memset(X, 0, n * sizeof(double));
+        memcpy(r, B, n * sizeof(double));
+        for (;; it++)
+        {
+            luSolveFloat(lu, ld, n, ipiv, r, d);
+            for (int i = 0; i < n; i++)
+                X[i] += d[i];
+
+            double scale = anorm * vecNormInf(X, n) + bnorm;
+            double next = residualInto(A, B, X, r, n) / (scale > 0 ? scale : 1);
+            if (next <= tol)
+            {
+                err = next;
+                break;
+            }
+            /* Refinement contracts only while κ(A) · 2⁻²⁴ < 1; then it stalls */
+            if (it == MIXED_MAX_ITER || !(next < 0.5 * err))
+            {
+                ok = 0;
+                break;
+            }
+            err = next;
+        }
+    }
+
+    if (ok)
+    {
+        lastRefine.iters = it;
+        lastRefine.residual = err;
+        if (D)
+        {
+            /* det(A) from the float pivots, det(Ai) = det(A) · Xi */
+            LogDet det = LOGDET_ONE;
+            for (int i = 0; i < n; i++)
+            {
+                if (ipiv[i] != i)
+                    det.sign = -det.sign;
+                det = logDetScale(det, lu[(size_t)i * ld + i]);
+            }
+            for (int i = 0; i < n; i++)
+                D[i] = logDetValue(logDetScale(det, X[i]));
+        }
+    }
+    else
+    {
+        memset(X, 0, n * sizeof(double));   // As if the float attempt never ran
+        linearSolveLU(A, B, X, D, n, ar);
+        lastRefine.iters = -1;
+        lastRefine.residual = relResidual(A, B, X, n);
+    }
+
+    free(ipiv);
+    free(r);
+    free(d);
+    if (ar == &local)
+        arenaRelease(&local);
+}
+
+/*****************************************************************************************
+ * SEQUENTIAL CRAMER SOLVER
+ *
+ * Steps:
+ * 1. Compute determinant of original matrix A
+ * 2. For each variable Xi:
+ *      - Replace column i of A with vector B
+ *      - Compute determinant of modified matrix
+ *      - Xi = det(Ai) / det(A)
+ *
+ * D (optional) receives every det(Ai). Scratch matrices come from `ar`; pass NULL
+ * to use a private arena for this call.
+ * In SOLVE_LU mode the work is handed to the single-factorization solver (in
+ * SOLVE_MIXED mode to its float version with refinement). In SOLVE_MIXED mode X
+ * is refined to double accuracy but D is not: det(A) comes from the float
+ * pivots, so each det(Ai) = det(A) · Xi carries float precision (double only
+ * when refinement fell back to linearSolveLU). In SOLVE_RANK1 mode each det(Ai)
+ * is det(A) times an entry of A⁻¹·B, solved once with the LU of step 1; in SOLVE_EXACT / SOLVE_MODULAR
+ * mode det(A) and every det(Ai) are exact integers (calcExactDet /
+ * calcModularDet). Cramer systems up to SMALL_DIM_MAX go to the fixed-size
+ * kernels.
+ *****************************************************************************************/
+void linearSolveSeq(const Grid *A, double *B, double *X, double *D, int n, ScratchArena *ar)
+{
+    if (solveMode == SOLVE_LU)
+    {
+        linearSolveLU(A, B, X, D, n, ar);
+        return;
+    }
+    if (solveMode == SOLVE_MIXED)
+    {
+        linearSolveMixed(A, B, X, D, n, ar);
+        return;
+    }
+    if (solveMode == SOLVE_CRAMER && useSmallKernel(n))
+    {
+        smallCramer[n](A, B, X, D);
+        return;
+    }
+
+    ScratchArena local;
+    if (!ar)
+    {
+        arenaInit(&local);
+        ar = &local;
+    }
+
+    LUFactor f = luDecompose(A, arenaGrid(ar, 0, n));
+    Grid *work = arenaGrid(ar, 1, n);   // f stays intact for the caller's later use
+    luSolveRank1(&f, B);
+    if (f.det.sign != 0)  // Otherwise no unique solution
+    {
+        for (int i = 0; i < n; i++)
+            columnSolve(A, &f, B, i, work, &X[i], D ? &D[i] : NULL);
+    }
+
+    luRelease(&f);
+    if (ar == &local)
+        arenaRelease(&local);
+}
+
+/*****************************************************************************************
+ * PARALLEL CRAMER SOLVER (PROCESS-BASED PARALLELISM)
+ *
+ * fork() creates a bounded pool of worker processes (not one per unknown).
+ * The parent writes the first column index of every chunk of columns into a pipe;
+ * each worker reads chunk indices until the pipe is drained and computes those Xi.
+ * Writes of one int are atomic, so every chunk goes to exactly one worker, and
+ * fast workers simply take more chunks.
+ *
+ * Important Concept:
+ * fork() creates separate memory spaces, so this demonstrates
+ * process-level parallelism rather than shared-memory parallelism.
+ * Results therefore travel through a ResultChannel: an anonymous MAP_SHARED
+ * mapping created before the fork, which every worker writes Xi, det(Ai) and a
+ * status flag into directly. The parent copies them out after wait().
+ *
+ * Every worker allocates its own scratch matrix for the det(Ai) eliminations.
+ * The LU of A is inherited read-only, so its pages stay shared with the parent
+ * instead of being copied on the first write.
+ *
+ * In SOLVE_LU and SOLVE_MIXED mode there is a single O(n³) factorization and
+ * nothing to hand out per unknown, so no children are created. In SOLVE_MODULAR
+ * mode a unit of work is one (column, prime) pair rather than a column: the worker
+ * stores det(Ai) mod p and the parent rebuilds every det(Ai) by CRT. All units
+ * cost the same, so the tail where one worker finishes a whole column alone
+ * disappears.
+ *
+ * How the workers are created is selectable (-C), because fork() copies the page
+ * tables of the parent and so gets slower as A grows:
+ *      fork    plain fork(), the children inherit A, B and the LU of A (default)
+ *      clone   clone3() with no sharing flags and SIGCHLD; the same copy as fork()
+ *              but without glibc's atfork handlers
+ *      vfork   vfork() + exec of this binary in worker mode: no page-table copy
+ *      spawn   posix_spawn() of the same binary (glibc also uses CLONE_VFORK)
+ * An exec'd worker inherits nothing but file descriptors, so for vfork and spawn
+ * the solve runs on a short-lived pool of the PREFORKED WORKER POOL kind: A, B
+ * and the results travel through a memfd region whose descriptor the workers
+ * inherit. -L measures the bare creation latency of every strategy per size.
+ *****************************************************************************************/
+
+#define CHUNKS_PER_PROC 4  /* Aim for this many chunks per worker for load balance */
+
+#define COLUMN_PENDING 0
+#define COLUMN_DONE    1
+
+static double spawnSeconds = 0;   /* Wall time the last solve spent in fork() (the CSV's spawn_time) */
+
+static double wallSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#define SPAWN_FORK  0
+#define SPAWN_VFORK 1
+#define SPAWN_POSIX 2
+#define SPAWN_CLONE 3
+#define SPAWN_MODES 4
+
+#define SPAWN_EXECS(mode) ((mode) == SPAWN_VFORK || (mode) == SPAWN_POSIX)
+
+#define WORKER_EXE "/proc/self/exe"
+
+static int spawnMode = SPAWN_FORK;   /* Selected with -C fork|vfork|spawn|clone */
+static const char *spawnNames[SPAWN_MODES] = { "fork", "vfork", "spawn", "clone" };
+
+/* Threads besides the caller: the team's pool threads or the DAG scheduler's */
+static int threadsRunning(void)
+{
+    return (teamReady && team.size > 1) || schedReady;
+}
+
+/*
+ * Get ready to create workers with `mode`. A clone child skips glibc's atfork
+ * handlers, so a lock (malloc, stdio) held by another thread at the time of the
+ * clone would stay locked in the child for good. Before cloning, the team and
+ * the DAG scheduler are therefore joined; both restart on their next use. Call
+ * this before starting the spawn clock.
+ */
+static void spawnPrepare(int mode)
+{
+    if (mode != SPAWN_CLONE || !threadsRunning())
+        return;
+    schedStop();
+    if (teamReady)
+    {
+        teamStop(&team);
+        teamReady = 0;
+    }
+}
+
+/* clone3() with no CLONE_* sharing flags; fork() where the kernel lacks it */
+static pid_t cloneProcess(void)
+{
+#ifdef SYS_clone3
+    /* struct clone_args (version 0): flags, pidfd, child_tid, parent_tid, exit_signal,
+       stack, stack_size, tls. A zero stack makes the child continue on a copy of ours */
+    uint64_t args[8] = { 0, 0, 0, 0, SIGCHLD, 0, 0, 0 };
+    long pid = syscall(SYS_clone3, args, sizeof(args));
+    if (pid >= 0 || errno != ENOSYS)
+        return (pid_t)pid;
+#endif
+    return fork();
+}
+
+/*
+ * Create a child with the given strategy. fork and clone return 0 in the child,
+ * which carries on like after fork(). vfork and spawn never return in the child:
+ * it executes argv (argv[0] is the program) and exits with 127 if that fails.
+ * clone is refused (EBUSY) while other threads run: see spawnPrepare.
+ */
+static pid_t spawnProcess(int mode, char *const argv[])
+{
+    pid_t pid;
+
+    switch (mode)
+    {
+    case SPAWN_VFORK:
+        pid = vfork();
+        if (pid == 0)   // Borrows our memory until exec: nothing but exec and _exit here
+        {
+            execv(argv[0], argv);
+            _exit(127);
+        }
+        return pid;
+    case SPAWN_POSIX:
+    {
+        int err = posix_spawn(&pid, argv[0], NULL, NULL, argv, environ);
+        if (err)
+        {
+            errno = err;
+            return -1;
+        }
+        return pid;
+    }
+    case SPAWN_CLONE:
+        if (threadsRunning())
+        {
+            errno = EBUSY;
+            return -1;
+        }
+        return cloneProcess();
+    default:
+        return fork();
+    }
+}
+
+typedef struct
+{
+    double *X;           /* Xi, written by the worker that owns column i */
+    double *D;           /* det(Ai) */
+    uint64_t *residue;   /* SOLVE_MODULAR: det(Ai) mod prime q at [i · primes + q] */
+    int *status;         /* COLUMN_DONE once unit u is valid */
+    int primes;          /* Units per column (1 unless SOLVE_MODULAR) */
+    size_t bytes;        /* Size of the whole mapping */
+} ResultChannel;
+
+/* Map a zero-filled result area shared with every process forked afterwards */
+static int openResults(ResultChannel *rc, int n, int primes)
+{
+    size_t units = (size_t)n * primes;
+    rc->bytes = (size_t)n * 2 * sizeof(double) + units * (sizeof(uint64_t) + sizeof(int));
+    void *base = mmap(NULL, rc->bytes ? rc->bytes : 1, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        perror("mmap");
+        return 0;
+    }
+    rc->X = base;
+    rc->D = rc->X + n;
+    rc->residue = (uint64_t *)(rc->D + n);
+    rc->status = (int *)(rc->residue + units);
+    rc->primes = primes;
+    return 1;
+}
+
+static void closeResults(ResultChannel *rc)
+{
+    munmap(rc->X, rc->bytes ? rc->bytes : 1);
+}
+
+/* Copy finished columns back to the caller; returns how many are missing */
+static int collectResults(const ResultChannel *rc, const LUFactor *f, double *X, double *D, int n)
+{
+    int missing = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int done = 1;
+        for (int q = 0; q < rc->primes; q++)
+            done &= (rc->status[(size_t)i * rc->primes + q] == COLUMN_DONE);
+        if (!done)
+        {
+            missing++;
+            continue;
+        }
+
+        if (solveMode == SOLVE_MODULAR)
+        {
+            modularColumn(f, rc->residue, rc->primes, i, &X[i], D ? &D[i] : NULL);
+            continue;
+        }
+        X[i] = rc->X[i];
+        if (D)
+            D[i] = rc->D[i];
+    }
+    return missing;
+}
+
+/* Worker loop: take chunks of units from the job pipe until it is empty, then exit */
+static void columnWorker(int jobFd, int chunk, const Grid *A, const LUFactor *f,
+                         double *B, ResultChannel *rc, int units)
+{
+    int start;
+    ScratchArena ar;   // Freed by _exit
+    arenaInit(&ar);
+    Grid *work = arenaGrid(&ar, 0, A->n);
+
+    /* The team's threads do not exist in a forked child; columns are the parallelism here */
+    detThreads = 1;
+
+    while (read(jobFd, &start, sizeof(start)) == sizeof(start))
+    {
+        int end = (start + chunk < units) ? start + chunk : units;
+        for (int u = start; u < end; u++)
+        {
+            if (solveMode == SOLVE_MODULAR)
+                rc->residue[u] = detModular(A, B, u / rc->primes, u % rc->primes);
+            else
+                columnSolve(A, f, B, u, work, &rc->X[u], &rc->D[u]);
+            rc->status[u] = COLUMN_DONE;
+        }
+    }
+    _exit(0);  // Skip stdio flushing of buffers inherited from the parent
+}
+
+/* Start the pool, feed it every chunk of units and wait until all workers exit */
+static void runColumnPool(const Grid *A, const LUFactor *f, double *B, ResultChannel *rc, int n)
+{
+    int jobs[2];
+    if (pipe(jobs) < 0)
+    {
+        perror("pipe");
+        return;
+    }
+
+    int units = n * rc->primes;
+    int workers = poolSize(units);
+    int chunk = units / (workers * CHUNKS_PER_PROC);
+    if (chunk < 1) chunk = 1;
+
+    int started = 0;
+    spawnPrepare(spawnMode);
+    double t0 = wallSeconds();
+    for (int w = 0; w < workers; w++)
+    {
+        pid_t pid = spawnProcess(spawnMode, NULL);   // fork or clone, see linearSolvePar
+        if (pid == 0)   // Child process: pins itself before its scratch is allocated
+        {
+            close(jobs[1]);
+            placeWorker(0, started);
+            columnWorker(jobs[0], chunk, A, f, B, rc, units);
+        }
+        if (pid < 0)
+        {
+            perror(spawnNames[spawnMode]);
+            break;
+        }
+        started++;
+    }
+    spawnSeconds += wallSeconds() - t0;
+    close(jobs[0]);
+
+    /* Hand out the chunks; closing the write end tells workers to finish */
+    for (int start = 0; start < units && started > 0; start += chunk)
+        if (write(jobs[1], &start, sizeof(start)) != sizeof(start))
+            break;
+    close(jobs[1]);
+
+    /* Parent waits for all workers to finish */
+    for (int w = 0; w < started; w++)
+        wait(NULL);
+}
+
+static void linearSolveExec(const Grid *A, double *B, double *X, double *D, int n,
+                            const LUFactor *f, int primes);
+
+void linearSolvePar(const Grid *A, double *B, double *X, double *D, int n, ScratchArena *ar)
+{
+    spawnSeconds = 0;
+    if (solveMode == SOLVE_LU)
+    {
+        linearSolveLU(A, B, X, D, n, ar);
+        return;
+    }
+    if (solveMode == SOLVE_MIXED)
+    {
+        linearSolveMixed(A, B, X, D, n, ar);
+        return;
+    }
+
+    ScratchArena local;
+    if (!ar)
+    {
+        arenaInit(&local);
+        ar = &local;
+    }
+
+    LUFactor f = luDecompose(A, arenaGrid(ar, 0, n));
+    ResultChannel rc;
+    int primes = (solveMode == SOLVE_MODULAR) ? modularPrimes(A, B) : 1;
+    luSolveRank1(&f, B);   // Before the fork, so every worker inherits it
+    if (f.det.sign != 0 && SPAWN_EXECS(spawnMode))
+    {
+        linearSolveExec(A, B, X, D, n, &f, primes);   // Exec'd workers cannot inherit A
+    }
+    else if (f.det.sign != 0 && openResults(&rc, n, primes))
+    {
+        runColumnPool(A, &f, B, &rc, n);
+
+        int missing = collectResults(&rc, &f, X, D, n);
+        if (missing)
+            fprintf(stderr, "Parallel solver: %d of %d columns not computed\n", missing, n);
+        closeResults(&rc);
+    }
+
+    luRelease(&f);
+    if (ar == &local)
+        arenaRelease(&local);
+}
+
+/*****************************************************************************************
+ * PREFORKED WORKER POOL (PROCESS-BASED PARALLELISM, PERSISTENT)
+ *
+ * linearSolvePar forks a new pool for every solve, so a size sweep pays process
+ * creation (and the page-table copy of a growing parent) once per size. The
+ * prefork backend forks its workers once and keeps them for the whole run:
+ *
+ *      parent ──PreforkJob──▶ job pipe ──▶ worker     (one descriptor per chunk)
+ *      parent ◀──PreforkDone── done pipe ◀── worker   (one per worker, one message per chunk)
+ *
+ * Everything a job needs lives in one MAP_SHARED region mapped before the fork:
+ * A, B, A⁻¹·B where the mode needs it (SOLVE_RANK1), and the result arrays.
+ * A descriptor carries the size, the unit range and the offsets into the region,
+ * so the same workers serve any n as long as the region is large enough; a job
+ * that does not fit restarts the pool with a larger region. main reserves room
+ * for the largest size up front (preforkReserve). Each worker keeps a private
+ * scratch arena across jobs. spawnSeconds records the process-creation time of
+ * each solve so that it can be reported apart from the compute time. The
+ * workers are reaped only by preforkStop, so their CPU time would not show up in
+ * RUSAGE_CHILDREN before the end of the run; instead every message carries the
+ * CPU time the worker used since its last one (getrusage(RUSAGE_SELF)), and
+ * stampNow adds the pool's total to par_child_cpu. Each worker has its own done
+ * pipe, so a worker that dies closes it and poll() reports POLLHUP at once.
+ *
+ * The region is a memfd where the kernel has one, and workers are created with
+ * the -C strategy. A vfork or spawn worker is this binary started as
+ *      /proc/self/exe --worker jobFd doneFd memFd bytes kernel
+ * which maps the inherited memfd and enters the same worker loop. linearSolvePar
+ * runs such a pool for a single solve when -C asks for an exec'd strategy.
+ *****************************************************************************************/
+
+
+typedef struct
+{
+    size_t a, b, rank1, exact;            /* Inputs */
+    size_t x, d, residue, status;         /* Results, laid out like a ResultChannel */
+    size_t bytes;                         /* End of the last array */
+} PreforkLayout;
+
+typedef struct
+{
+    int id;              /* Job number; per-job setup in a worker runs when it changes */
+    int n, ld;           /* System size and row stride of A and its LU in the region */
+    int start, end;      /* Units [start, end) of this chunk */
+    int primes;          /* Units per column (1 unless SOLVE_MODULAR) */
+    int mode, pivot, block;
+    LogDet det;          /* det(A) */
+    int exactSign;       /* det(A) as an integer in SOLVE_EXACT / SOLVE_MODULAR mode */
+    int exactLen;
+    PreforkLayout at;
+} PreforkJob;
+
+typedef struct
+{
+    int units;           /* Units of the chunk just finished */
+    double cpu;          /* CPU seconds the worker used since its previous message */
+} PreforkDone;
+
+typedef struct
+{
+    int size;            /* Workers running; 0 before the first job */
+    pid_t *pids;
+    int *doneFds;        /* Read end of each worker's completion pipe */
+    int jobFd;           /* Write end of the job pipe */
+    char *region;        /* Shared with every worker */
+    size_t capacity;
+    int nextId;
+    double cpu;          /* CPU seconds reported by the workers not yet reaped */
+} PreforkPool;
+
+static PreforkPool prefork;
+static int preforkDim = 0;   /* Region sized for n up to this from the start */
+
+static size_t layoutSlot(size_t *at, size_t bytes)
+{
+    size_t off = *at;
+    *at += (bytes + GRID_ALIGN - 1) / GRID_ALIGN * GRID_ALIGN;
+    return off;
+}
+
+static PreforkLayout preforkLayout(int n, int ld, int primes, int exactLen)
+{
+    PreforkLayout l;
+    size_t at = 0, units = (size_t)n * primes;
+    l.a = layoutSlot(&at, (size_t)n * ld * sizeof(double));
+    l.b = layoutSlot(&at, n * sizeof(double));
+    l.rank1 = layoutSlot(&at, n * sizeof(double));
+    l.exact = layoutSlot(&at, exactLen * sizeof(uint64_t));
+    l.x = layoutSlot(&at, n * sizeof(double));
+    l.d = layoutSlot(&at, n * sizeof(double));
+    l.residue = layoutSlot(&at, units * sizeof(uint64_t));
+    l.status = layoutSlot(&at, units * sizeof(int));
+    l.bytes = at;
+    return l;
+}
+
+/* Size the shared region for systems up to n before the pool starts */
+void preforkReserve(int n)
+{
+    preforkDim = (n > preforkDim) ? n : preforkDim;
+}
+
+/* Map a zero-filled shared region; *fd is its memfd, or −1 if only fork can share it */
+static char *regionMap(size_t bytes, int *fd)
+{
+    *fd = memfd_create("cramer-region", 0);   // Not close-on-exec: workers inherit it
+    if (*fd >= 0 && ftruncate(*fd, bytes) < 0)
+    {
+        close(*fd);
+        *fd = -1;
+    }
+
+    char *region = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | (*fd < 0 ? MAP_ANONYMOUS : 0), *fd, 0);
+    if (region == MAP_FAILED)
+    {
+        perror("mmap");
+        if (*fd >= 0)
+            close(*fd);
+        return NULL;
+    }
+    memPolicy(region, bytes, MEM_SHARED);
+    return region;
+}
+
+/* User + system CPU seconds of this process */
+static double selfCpuSeconds(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1e-6;
+}
+
+/* Worker loop: run chunks until the job pipe is closed */
+static void preforkWorker(int jobFd, int doneFd, char *region)
+{
+    ScratchArena ar;
+    PreforkJob job;
+    int lastId = -1;
+    double cpu = selfCpuSeconds();
+
+    arenaInit(&ar);
+    detThreads = 1;   // As in columnWorker: no thread team in a forked child
+
+    while (read(jobFd, &job, sizeof(job)) == sizeof(job))
+    {
+        Grid A = { (double *)(region + job.at.a), job.n, job.ld, 0 };
+        double *B = (double *)(region + job.at.b);
+        LUFactor f = { NULL, job.det, NULL, NULL,   // The Cramer loop needs no factors
+                       { job.exactSign, job.exactLen, (uint64_t *)(region + job.at.exact) },
+                       (double *)(region + job.at.rank1) };
+        ResultChannel rc = { (double *)(region + job.at.x), (double *)(region + job.at.d),
+                             (uint64_t *)(region + job.at.residue), (int *)(region + job.at.status),
+                             job.primes, 0 };
+
+        solveMode = job.mode;
+        pivotMode = job.pivot;
+        luBlock = job.block;
+        if (job.id != lastId && solveMode == SOLVE_MODULAR)
+            modularPrimes(&A, B);   // Extends this process's prime table
+        lastId = job.id;
+
+        Grid *work = arenaGrid(&ar, 0, job.n);
+        for (int u = job.start; u < job.end; u++)
+        {
+            if (solveMode == SOLVE_MODULAR)
+                rc.residue[u] = detModular(&A, B, u / rc.primes, u % rc.primes);
+            else
+                columnSolve(&A, &f, B, u, work, &rc.X[u], &rc.D[u]);
+            rc.status[u] = COLUMN_DONE;
+        }
+
+        PreforkDone done = { job.end - job.start, selfCpuSeconds() - cpu };
+        cpu += done.cpu;
+        if (write(doneFd, &done, sizeof(done)) != sizeof(done))
+            break;
+    }
+    _exit(0);
+}
+
+/* main() of an exec'd worker; argv is "--worker" jobFd doneFd memFd bytes kernel */
+int preforkExecWorker(char *argv[])
+{
+    int jobFd = atoi(argv[1]), doneFd = atoi(argv[2]), memFd = atoi(argv[3]);
+    size_t bytes = strtoull(argv[4], NULL, 10);
+
+    selectKernels(argv[5]);   // The parent's choice, which this CPU supports
+    char *region = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (region == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    close(memFd);
+    preforkWorker(jobFd, doneFd, region);
+    return 0;
+}
+
+/* Close the job pipe, reap every worker and unmap the region */
+static void poolStop(PreforkPool *pool)
+{
+    if (pool->size == 0)
+        return;
+
+    close(pool->jobFd);
+    for (int w = 0; w < pool->size; w++)
+    {
+        close(pool->doneFds[w]);
+        waitpid(pool->pids[w], NULL, 0);
+    }
+    munmap(pool->region, pool->capacity);
+    free(pool->pids);
+    free(pool->doneFds);
+    pool->size = 0;
+    pool->cpu = 0;   // Reaped: RUSAGE_CHILDREN has their CPU time now
+}
+
+void preforkStop(void)
+{
+    poolStop(&prefork);
+}
+
+/* Create `workers` processes with strategy `mode` around a new region of `capacity` bytes */
+static int poolStart(PreforkPool *pool, int workers, size_t capacity, int mode)
+{
+    int jobs[2], done[2], memFd;
+    char *region = regionMap(capacity, &memFd);
+    if (!region)
+        return 0;
+    if (pipe(jobs) < 0)
+    {
+        perror("pipe");
+        munmap(region, capacity);
+        if (memFd >= 0)
+            close(memFd);
+        return 0;
+    }
+
+    /* Our end must not survive an exec, or the job pipe would never reach EOF */
+    fcntl(jobs[1], F_SETFD, FD_CLOEXEC);
+
+    if (SPAWN_EXECS(mode) && memFd < 0)
+    {
+        fprintf(stderr, "No memfd to share with exec'd workers, using fork\n");
+        mode = SPAWN_FORK;
+    }
+
+    char fds[4][24];
+    snprintf(fds[0], sizeof(fds[0]), "%d", jobs[0]);
+    snprintf(fds[2], sizeof(fds[2]), "%d", memFd);
+    snprintf(fds[3], sizeof(fds[3]), "%zu", capacity);
+    char *argv[] = { WORKER_EXE, "--worker", fds[0], fds[1], fds[2], fds[3],
+                     (char *)kern.name, NULL };
+
+    pool->pids = malloc(workers * sizeof(pid_t));
+    pool->doneFds = malloc(workers * sizeof(int));
+    pool->region = region;
+    pool->capacity = capacity;
+    pool->size = 0;
+    pool->cpu = 0;
+
+    spawnPrepare(mode);
+    double t0 = wallSeconds();
+    for (int w = 0; w < workers; w++)
+    {
+        /* A private done pipe: only this worker holds the write end */
+        if (pipe(done) < 0)
+        {
+            perror("pipe");
+            break;
+        }
+        fcntl(done[0], F_SETFD, FD_CLOEXEC);
+        snprintf(fds[1], sizeof(fds[1]), "%d", done[1]);
+
+        pid_t pid = spawnProcess(mode, argv);
+        if (pid == 0)   // Child process (fork and clone)
+        {
+            close(jobs[1]);
+            close(done[0]);
+            placeWorker(0, pool->size);
+            preforkWorker(jobs[0], done[1], region);
+        }
+        close(done[1]);
+        if (pid < 0)
+        {
+            perror(spawnNames[mode]);
+            close(done[0]);
+            break;
+        }
+        if (SPAWN_EXECS(mode))
+            placeWorker(pid, pool->size);   // An exec'd worker cannot pin itself
+        pool->doneFds[pool->size] = done[0];
+        pool->pids[pool->size++] = pid;
+    }
+    spawnSeconds += wallSeconds() - t0;
+
+    close(jobs[0]);
+    if (memFd >= 0)
+        close(memFd);   // The workers hold their own copies
+    pool->jobFd = jobs[1];
+    if (pool->size == 0)
+    {
+        poolStop(pool);
+        return 0;
+    }
+    return 1;
+}
+
+/* Make sure a prefork pool with at least `bytes` of shared region is running */
+static int preforkReady(size_t bytes)
+{
+    if (prefork.size > 0 && bytes <= prefork.capacity)
+        return 1;
+
+    preforkStop();
+    size_t reserve = preforkLayout(preforkDim, gridStride(preforkDim > 0 ? preforkDim : 1), 1, 0).bytes;
+    size_t capacity = (bytes > reserve) ? 2 * bytes : reserve;   // Headroom after outgrowing it
+    if (prefork.capacity > capacity)
+        capacity = prefork.capacity;   // Never shrink after a restart
+
+    return poolStart(&prefork, poolSize(1 << 30), capacity, spawnMode);
+}
+
+/* Wait for `units` completed units; 0 if a worker died first */
+static int poolWait(PreforkPool *pool, int units)
+{
+    struct pollfd *pfd = malloc(pool->size * sizeof(struct pollfd));
+    for (int w = 0; w < pool->size; w++)
+        pfd[w] = (struct pollfd){ pool->doneFds[w], POLLIN, 0 };
+
+    int dead = 0;
+    while (units > 0 && !dead)
+    {
+        if (poll(pfd, pool->size, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            break;
+        }
+        for (int w = 0; w < pool->size; w++)
+        {
+            if (!pfd[w].revents)
+                continue;
+            PreforkDone done;
+            if (read(pfd[w].fd, &done, sizeof(done)) != sizeof(done))
+            {
+                dead = 1;   // POLLHUP with nothing left to read: the worker is gone
+                break;
+            }
+            units -= done.units;
+            pool->cpu += done.cpu;
+        }
+    }
+    free(pfd);
+
+    if (units > 0)
+    {
+        fprintf(stderr, "Worker pool: a worker died, stopping the pool\n");
+        return 0;
+    }
+    return 1;
+}
+
+/* Copy one system into the pool's region, run all its units and collect; returns columns missing */
+static int poolSolve(PreforkPool *pool, const Grid *A, double *B, double *X, double *D, int n,
+                     const LUFactor *f, int primes, const PreforkLayout *at)
+{
+    char *region = pool->region;
+    int ld = gridStride(n > 0 ? n : 1), units = n * primes;
+    PreforkJob job = { pool->nextId++, n, ld, 0, 0, primes, solveMode, pivotMode, luBlock,
+                       f->det, f->exact.sign, f->exact.len, *at };
+
+    for (int i = 0; i < n; i++)
+        memcpy(region + at->a + (size_t)i * ld * sizeof(double), GRID_ROW(A, i), n * sizeof(double));
+    memcpy(region + at->b, B, n * sizeof(double));
+    if (f->rank1)
+        memcpy(region + at->rank1, f->rank1, n * sizeof(double));
+    if (f->exact.len)
+        memcpy(region + at->exact, f->exact.limb, f->exact.len * sizeof(uint64_t));
+    memset(region + at->status, 0, (size_t)units * sizeof(int));
+
+    /* Same chunking as runColumnPool */
+    int chunk = units / (pool->size * CHUNKS_PER_PROC), sent = 0;
+    if (chunk < 1) chunk = 1;
+    for (job.start = 0; job.start < units; job.start += chunk)
+    {
+        job.end = (job.start + chunk < units) ? job.start + chunk : units;
+        if (write(pool->jobFd, &job, sizeof(job)) != sizeof(job))
+            break;
+        sent += job.end - job.start;
+    }
+
+    int alive = poolWait(pool, sent);
+
+    /* Units finished before a worker died are still valid */
+    ResultChannel rc = { (double *)(region + at->x), (double *)(region + at->d),
+                         (uint64_t *)(region + at->residue), (int *)(region + at->status),
+                         primes, 0 };
+    int missing = collectResults(&rc, f, X, D, n);
+    if (!alive)
+        poolStop(pool);   // preforkReady starts a new one for the next job
+    return missing;
+}
+
+void linearSolvePrefork(const Grid *A, double *B, double *X, double *D, int n, ScratchArena *ar)
+{
+    spawnSeconds = 0;
+    if (solveMode == SOLVE_LU)
+    {
+        linearSolveLU(A, B, X, D, n, ar);
+        return;
+    }
+    if (solveMode == SOLVE_MIXED)
+    {
+        linearSolveMixed(A, B, X, D, n, ar);
+        return;
+    }
+
+    ScratchArena local;
+    if (!ar)
+    {
+        arenaInit(&local);
+        ar = &local;
+    }
+
+    LUFactor f = luDecompose(A, arenaGrid(ar, 0, n));
+    int primes = (solveMode == SOLVE_MODULAR) ? modularPrimes(A, B) : 1;
+    luSolveRank1(&f, B);
+    PreforkLayout at = preforkLayout(n, gridStride(n > 0 ? n : 1), primes, f.exact.len);
+
+    if (f.det.sign != 0 && preforkReady(at.bytes))
+    {
+        int missing = poolSolve(&prefork, A, B, X, D, n, &f, primes, &at);
+        if (missing)
+            fprintf(stderr, "Prefork solver: %d of %d columns not computed\n", missing, n);
+    }
+
+    luRelease(&f);
+    if (ar == &local)
+        arenaRelease(&local);
+}
+
+/* linearSolvePar with exec'd workers: a pool that lives for this one solve */
+static void linearSolveExec(const Grid *A, double *B, double *X, double *D, int n,
+                            const LUFactor *f, int primes)
+{
+    PreforkPool pool = { 0 };
+    PreforkLayout at = preforkLayout(n, gridStride(n > 0 ? n : 1), primes, f->exact.len);
+
+    if (!poolStart(&pool, poolSize(n * primes), at.bytes, spawnMode))
+        return;
+    int missing = poolSolve(&pool, A, B, X, D, n, f, primes, &at);
+    if (missing)
+        fprintf(stderr, "Parallel solver: %d of %d columns not computed\n", missing, n);
+    poolStop(&pool);
+}
+
+/*****************************************************************************************
+ * PARALLEL CRAMER SOLVER (THREAD-BASED PARALLELISM)
+ *
+ * The same column loop as linearSolvePar, run by a pool of POSIX threads. All
+ * threads read the one shared copy of A and B and write X and D directly, so there
+ * is no fork, page-table copy or copy-on-write fault per worker. Columns are taken
+ * in chunks from an atomic counter; each thread owns a scratch arena that survives
+ * across solves. In SOLVE_MODULAR mode the counter hands out (column, prime) units.
+ *****************************************************************************************/
+
+typedef struct
+{
+    const Grid *A;
+    const LUFactor *f;
+    const double *B;
+    double *X;
+    double *D;
+    int n;
+    int chunk;
+    ScratchArena *arenas;
+    atomic_int next;           /* First unit of the next unclaimed chunk */
+    uint64_t *residue;         /* SOLVE_MODULAR: det(Ai) mod prime q at [i · primes + q] */
+    int primes;                /* Units per column (1 unless SOLVE_MODULAR) */
+} ColumnJob;
+
+static void columnTask(void *arg, int tid, int nthreads)
+{
+    ColumnJob *job = arg;
+    int n = job->n, units = n * job->primes;
+    Grid *work = (solveMode == SOLVE_CRAMER) ? arenaGrid(&job->arenas[tid], 0, n) : NULL;
+    (void)nthreads;
+
+    for (;;)
+    {
+        int start = atomic_fetch_add(&job->next, job->chunk);
+        if (start >= units)
+            break;
+
+        int end = (start + job->chunk < units) ? start + job->chunk : units;
+        for (int u = start; u < end; u++)
+        {
+            if (solveMode == SOLVE_MODULAR)
+                job->residue[u] = detModular(job->A, job->B, u / job->primes, u % job->primes);
+            else
+                columnSolve(job->A, job->f, job->B, u, work, &job->X[u], job->D ? &job->D[u] : NULL);
+        }
+    }
+}
+
+void linearSolveThreads(const Grid *A, double *B, double *X, double *D, int n, ScratchArena *ar)
+{
+    if (solveMode == SOLVE_LU)
+    {
+        linearSolveLU(A, B, X, D, n, ar);
+        return;
+    }
+    if (solveMode == SOLVE_MIXED)
+    {
+        linearSolveMixed(A, B, X, D, n, ar);
+        return;
+    }
+
+    ScratchArena local;
+    if (!ar)
+    {
+        arenaInit(&local);
+        ar = &local;
+    }
+
+    LUFactor f = luDecompose(A, arenaGrid(ar, 0, n));
+    luSolveRank1(&f, B);
+
+    if (f.det.sign != 0)
+    {
+        ThreadTeam *t = sharedTeam();
+        ColumnJob job = { A, &f, B, X, D, n, 0, t->arenas, 0, NULL, 1 };
+        if (solveMode == SOLVE_MODULAR)
+        {
+            job.primes = modularPrimes(A, B);
+            job.residue = malloc((size_t)n * job.primes * sizeof(uint64_t));
+        }
+        job.chunk = n * job.primes / (t->size * CHUNKS_PER_PROC);
+        if (job.chunk < 1) job.chunk = 1;
+
+        teamRun(t, columnTask, &job);
+
+        if (job.residue)
+        {
+            for (int i = 0; i < n; i++)
+                modularColumn(&f, job.residue, job.primes, i, &X[i], D ? &D[i] : NULL);
+            free(job.residue);
+        }
+    }
+
+    luRelease(&f);
+    if (ar == &local)
+        arenaRelease(&local);
+}
+
+/*****************************************************************************************
+ * PARALLEL CRAMER SOLVER (TASK-DAG SCHEDULER)
+ *
+ * Every determinant of the Cramer loop (det(A) and the n det(Ai)) becomes one tiled
+ * LU DAG, and all of them are fed into the same work-stealing scheduler. Tiles of
+ * different determinants fill the cores that a single DAG leaves idle near its end.
+ * At most (workers + 1) DAGs are in flight, each with its own scratch matrix, and a
+ * finished DAG's matrix is refilled with the next column at once: the first
+ * elimination step writes it straight from A, so there is no copy of A first.
+ *
+ * Only the Cramer mode has n + 1 factorizations to overlap; the other modes are
+ * handed to the thread backend.
+ *****************************************************************************************/
+
+/*
+ * Start the next system (A for tag 0, Ai for tag i + 1) in g: its first
+ * elimination step is done here straight from A (luFirstStep) and the DAG gets
+ * the trailing (n − 1) × (n − 1) view. Systems settled by that step alone are
+ * recorded in dets and skipped. Returns 0 once every system has been started.
+ */
+static int dagFeed(LUDag *d, Grid *g, LogDet *lead, DagGroup *grp, const Grid *A,
+                   const double *B, int n, int *next, LogDet *dets)
+{
+    while (*next <= n)
+    {
+        int tag = (*next)++;
+        *lead = luFirstStep(A, B, tag - 1, g);
+        if (lead->sign == 0 || g->n == 0)
+        {
+            dets[tag] = *lead;
+            continue;
+        }
+        dagSubmit(d, g, luBlock, grp, tag);
+        return 1;
+    }
+    return 0;
+}
+
+void linearSolveDag(const Grid *A, double *B, double *X, double *D, int n, ScratchArena *ar)
+{
+    /* The DAG only knows row exchanges; column pivoting runs unblocked anyway */
+    if (solveMode != SOLVE_CRAMER || n == 0 ||
+        pivotMode == PIVOT_COMPLETE || pivotMode == PIVOT_ROOK)
+    {
+        linearSolveThreads(A, B, X, D, n, ar);
+        return;
+    }
+
+    schedStart();
+    int window = (sched.size + 1 < n + 1) ? sched.size + 1 : n + 1;
+    LUDag *dags = calloc(window, sizeof(LUDag));
+    Grid *grids = calloc(window, sizeof(Grid));
+    LogDet *dets = calloc(n + 1, sizeof(LogDet));      // dets[0] = det(A), dets[i + 1] = det(Ai)
+    LogDet *lead = malloc(window * sizeof(LogDet));    // First-step factor of each slot's system
+    DagGroup grp;
+    int next = 0, inFlight = 0;
+
+    groupInit(&grp);
+    for (int slot = 0; slot < window; slot++)
+    {
+        grids[slot] = makeGridFor(n, MEM_SHARED);   // Tiles are updated by every thread
+        inFlight += dagFeed(&dags[slot], &grids[slot], &lead[slot], &grp, A, B, n, &next, dets);
+    }
+
+    while (inFlight > 0)
+    {
+        LUDag *d = groupWait(&grp);
+        int slot = (int)(d - dags);
+        dets[d->tag] = logDetMul(lead[slot], dagFinish(d, NULL));
+        inFlight--;
+
+        inFlight += dagFeed(d, &grids[slot], &lead[slot], &grp, A, B, n, &next, dets);
+    }
+
+    if (dets[0].sign != 0)  // Otherwise no unique solution
+    {
+        for (int i = 0; i < n; i++)
+        {
+            X[i] = logDetRatio(dets[i + 1], dets[0]);
+            if (D)
+                D[i] = logDetValue(dets[i + 1]);
+        }
+    }
+
+    groupDestroy(&grp);
+    for (int slot = 0; slot < window; slot++)
+        destroyGrid(&grids[slot]);
+    free(grids);
+    free(dags);
+    free(dets);
+    free(lead);
+}
+
+/*****************************************************************************************
+ * BATCHED SMALL SYSTEMS
+ *
+ * Many independent n × n systems solved in one call. linearSolveLU pays a factor
+ * allocation, a pivot array and a scalar loop nest per system, which for n = 8..64
+ * costs more than the arithmetic. A SystemBatch instead stores the systems
+ * interleaved by lane (structure of arrays):
+ *
+ *      A[g][i][j][l] = entry (i, j) of system g · lanes + l
+ *
+ * so one lane group is a single n × n matrix of lanes-wide vectors and the batch
+ * kernel eliminates all of its systems in lockstep with partial pivoting. The lane
+ * count is that of the kernel set selected when the batch is created.
+ * linearSolveBatch hands lane groups to the thread team in chunks.
+ *****************************************************************************************/
+
+typedef struct
+{
+    int n;
+    int count;        /* Systems stored */
+    int lanes;        /* Systems per lane group (kern.batchLanes) */
+    int groups;       /* Lane groups, count rounded up to lanes */
+    BatchKernel solve;    /* The kernel for this lane count */
+    double *A;        /* groups × n × n × lanes, overwritten by the solve */
+    double *B;        /* groups × n × lanes, overwritten by the solve */
+    double *X;        /* groups × n × lanes */
+    double *det;      /* groups × lanes; 0 marks a singular system (X = 0) */
+} SystemBatch;
+
+/* Offset of system s of batch sb in an interleaved array with k entries per system */
+#define BATCH_ENTRY(sb, s, k) \
+    ((size_t)((s) / (sb)->lanes) * (k) * (sb)->lanes + (s) % (sb)->lanes)
+
+static double *batchAlloc(size_t count)
+{
+    size_t bytes = (count * sizeof(double) + GRID_ALIGN - 1) / GRID_ALIGN * GRID_ALIGN;
+    double *p = aligned_alloc(GRID_ALIGN, bytes);
+    if (!p)
+    {
+        perror("batchInit");
+        exit(1);
+    }
+    return p;
+}
+
+/* Room for `count` systems of dimension n; unused lanes hold I·x = 0 */
+void batchInit(SystemBatch *sb, int n, int count)
+{
+    sb->n = n;
+    sb->count = count;
+    sb->lanes = kern.batchLanes;
+    sb->solve = kern.batch;
+    sb->groups = (count + sb->lanes - 1) / sb->lanes;
+
+    size_t lanes = (size_t)sb->groups * sb->lanes;
+    sb->A = batchAlloc(lanes * n * n);
+    sb->B = batchAlloc(lanes * n);
+    sb->X = batchAlloc(lanes * n);
+    sb->det = batchAlloc(lanes);
+
+    /* Fault every page in now, not in the first batchSetSystem calls */
+    memset(sb->A, 0, lanes * n * n * sizeof(double));
+    memset(sb->B, 0, lanes * n * sizeof(double));
+    memset(sb->X, 0, lanes * n * sizeof(double));
+    for (size_t s = count; s < lanes; s++)
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                sb->A[BATCH_ENTRY(sb, s, n * n) + (size_t)(i * n + j) * sb->lanes] = (i == j);
+}
+
+void batchFree(SystemBatch *sb)
+{
+    free(sb->A);
+    free(sb->B);
+    free(sb->X);
+    free(sb->det);
+    sb->A = sb->B = sb->X = sb->det = NULL;
+}
+
+/* Store system s: A (n × n) and right-hand side B */
+void batchSetSystem(SystemBatch *sb, int s, const Grid *A, const double *B)
+{
+    int n = sb->n;
+    double *a = sb->A + BATCH_ENTRY(sb, s, n * n);
+    double *b = sb->B + BATCH_ENTRY(sb, s, n);
+
+    for (int i = 0; i < n; i++)
+    {
+        const double *row = GRID_ROW(A, i);
+        for (int j = 0; j < n; j++)
+            a[(size_t)(i * n + j) * sb->lanes] = row[j];
+        b[(size_t)i * sb->lanes] = B[i];
+    }
+}
+
+/* Solution of system s after linearSolveBatch; returns its determinant */
+double batchGetSolution(const SystemBatch *sb, int s, double *X)
+{
+    int n = sb->n;
+    const double *x = sb->X + BATCH_ENTRY(sb, s, n);
+
+    for (int i = 0; i < n; i++)
+        X[i] = x[(size_t)i * sb->lanes];
+    return sb->det[BATCH_ENTRY(sb, s, 1)];
+}
+
+typedef struct
+{
+    SystemBatch *sb;
+    int chunk;
+    atomic_int next;   /* First lane group of the next unclaimed chunk */
+} BatchJob;
+
+static void batchSolveGroups(SystemBatch *sb, int from, int to)
+{
+    int n = sb->n;
+    size_t stride = (size_t)n * sb->lanes;
+
+    for (int g = from; g < to; g++)
+        sb->solve(sb->A + g * stride * n, sb->B + g * stride, sb->X + g * stride,
+                  sb->det + (size_t)g * sb->lanes, n);
+}
+
+static void batchTask(void *arg, int tid, int nthreads)
+{
+    BatchJob *job = arg;
+    (void)tid;
+    (void)nthreads;
+
+    for (;;)
+    {
+        int start = atomic_fetch_add(&job->next, job->chunk);
+        if (start >= job->sb->groups)
+            break;
+
+        int end = start + job->chunk;
+        batchSolveGroups(job->sb, start, end < job->sb->groups ? end : job->sb->groups);
+    }
+}
+
+/* Solve every system in the batch; A and B are consumed */
+void linearSolveBatch(SystemBatch *sb)
+{
+    if (sb->groups <= 1)
+    {
+        batchSolveGroups(sb, 0, sb->groups);
+        return;
+    }
+
+    ThreadTeam *t = sharedTeam();
+    BatchJob job = { sb, 0, 0 };
+    job.chunk = sb->groups / (t->size * CHUNKS_PER_PROC);
+    if (job.chunk < 1) job.chunk = 1;
+
+    teamRun(t, batchTask, &job);
+}
+
+/*****************************************************************************************
+ * MAIN FUNCTION — PERFORMANCE DRIVER
+ *
+ * Accepts multiple matrix sizes from command line,
+ * runs both sequential and parallel solvers,
+ * measures execution time, and writes results to CSV.
+ * The parallel result is checked against the sequential one (max_diff column).
+ *
+ * Timing: clock() only counts the parent's CPU time, which hides all the work done
+ * by forked children. Every phase therefore records
+ *      - monotonic wall time          (clock_gettime(CLOCK_MONOTONIC))
+ *      - parent CPU time              (getrusage(RUSAGE_SELF))
+ *      - CPU time of reaped children  (getrusage(RUSAGE_CHILDREN))
+ * and speedup is the ratio of wall times.
+ *
+ * -B selects the parallel backend (fork, threads, dag, prefork, both = fork +
+ * threads, or all). With several, each size is solved by every selected backend on the same
+ * matrix and gets one CSV row per backend. -S replaces all of them with the
+ * batched solver on many systems of each size, -R with the multiple right-hand
+ * side solvers, -F with the fixed-size kernels against the general path.
+ *****************************************************************************************/
+
+#define BACKEND_FORK    1
+#define BACKEND_THREADS 2
+#define BACKEND_DAG     4
+#define BACKEND_PREFORK 8
+
+static const char *backendName(int backend)
+{
+    if (backend == BACKEND_DAG)
+        return "dag";
+    if (backend == BACKEND_PREFORK)
+        return "prefork";
+    return (backend == BACKEND_THREADS) ? "threads" : "fork";
+}
+
+typedef struct
+{
+    double wall;       /* Monotonic wall-clock seconds */
+    double selfCpu;    /* User + system CPU of this process */
+    double childCpu;   /* User + system CPU of all reaped children */
+} Stamp;
+
+static double tvSeconds(struct timeval tv)
+{
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static Stamp stampNow(void)
+{
+    Stamp st;
+    struct timespec ts;
+    struct rusage ru;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    st.wall = ts.tv_sec + ts.tv_nsec * 1e-9;
+
+    getrusage(RUSAGE_SELF, &ru);
+    st.selfCpu = tvSeconds(ru.ru_utime) + tvSeconds(ru.ru_stime);
+
+    getrusage(RUSAGE_CHILDREN, &ru);
+    st.childCpu = tvSeconds(ru.ru_utime) + tvSeconds(ru.ru_stime) + prefork.cpu;   // Not reaped yet
+    return st;
+}
+
+/* Elapsed wall, parent CPU and children CPU between two stamps */
+static Stamp stampDiff(Stamp from, Stamp to)
+{
+    Stamp d = { to.wall - from.wall, to.selfCpu - from.selfCpu, to.childCpu - from.childCpu };
+    return d;
+}
+
+/* Largest |a[i] − b[i]|, relative to |a[i]| when that exceeds 1 */
+static double maxRelDiff(const double *a, const double *b, int n)
+{
+    double worst = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double scale = fabs(a[i]) > 1 ? fabs(a[i]) : 1;
+        double d = fabs(a[i] - b[i]) / scale;
+        if (!(d <= worst))  // Also catches NaN
+            worst = d;
+    }
+    return worst;
+}
+
+/*
+ * -S count: `count` random systems of dimension n, solved one by one with
+ * linearSolveLU (seq) and as one SystemBatch (par, backend "batch"). Packing the
+ * batch and unpacking the solutions count towards the batched time.
+ */
+static void runBatch(FILE *fp, int n, int count, ScratchArena *ar)
+{
+    Grid *A = malloc(count * sizeof(Grid));
+    double *B = malloc((size_t)count * n * sizeof(double));
+    double *X = calloc((size_t)count * n, sizeof(double));
+    double *Xbat = calloc((size_t)count * n, sizeof(double));
+
+    for (int s = 0; s < count; s++)
+    {
+        A[s] = makeGrid(n);
+        for (int i = 0; i < n; i++)
+        {
+            B[(size_t)s * n + i] = rand() % 10;
+            for (int j = 0; j < n; j++)
+                GRID_ROW(&A[s], i)[j] = rand() % 10;
+        }
+    }
+
+    /* The one-at-a-time baseline is the LU path, whatever -m says */
+    int mode = solveMode;
+    solveMode = SOLVE_LU;
+    Stamp t1 = stampNow();
+    for (int s = 0; s < count; s++)
+        linearSolveLU(&A[s], B + (size_t)s * n, X + (size_t)s * n, NULL, n, ar);
+    Stamp seq = stampDiff(t1, stampNow());
+    solveMode = mode;
+
+    SystemBatch sb;
+    batchInit(&sb, n, count);
+    t1 = stampNow();
+    for (int s = 0; s < count; s++)
+        batchSetSystem(&sb, s, &A[s], B + (size_t)s * n);
+    linearSolveBatch(&sb);
+    for (int s = 0; s < count; s++)
+        batchGetSolution(&sb, s, Xbat + (size_t)s * n);
+    Stamp par = stampDiff(t1, stampNow());
+
+    double speedup = (par.wall > 0) ? seq.wall / par.wall : 0;
+    double maxDiff = maxRelDiff(X, Xbat, count * n);
+
+    printf("Seq: %.3f sec | Par (batch of %d): %.3f sec, %.0f ns/system | "
+           "Speedup: %.2f | Max diff: %.2e\n",
+           seq.wall, count, par.wall, par.wall * 1e9 / count, speedup, maxDiff);
+
+    fprintf(fp, "%d,%.5f,%.5f,%.2f,%.3e,%.5f,%.5f,%.5f,batch,,,,,%s,\n",
+            n, seq.wall, par.wall, speedup, maxDiff, seq.selfCpu, par.selfCpu, par.childCpu,
+            numaLabel());
+    fflush(fp);
+
+    batchFree(&sb);
+    for (int s = 0; s < count; s++)
+        destroyGrid(&A[s]);
+    free(A);
+    free(B);
+    free(X);
+    free(Xbat);
+}
+
+/*
+ * -F count: `count` random n × n systems solved by linearSolveSeq through the
+ * general path (seq) and through the fixed-size kernels (par, backend "fixed"),
+ * reported in nanoseconds per system. Only n ≤ SMALL_DIM_MAX differ.
+ */
+static void runFixed(FILE *fp, int n, int count, ScratchArena *ar)
+{
+    Grid *A = malloc(count * sizeof(Grid));
+    double *B = malloc((size_t)count * n * sizeof(double));
+    double *X = calloc((size_t)count * n, sizeof(double));
+    double *Xfix = calloc((size_t)count * n, sizeof(double));
+
+    for (int s = 0; s < count; s++)
+    {
+        A[s] = makeGrid(n);
+        for (int i = 0; i < n; i++)
+        {
+            B[(size_t)s * n + i] = rand() % 10;
+            for (int j = 0; j < n; j++)
+                GRID_ROW(&A[s], i)[j] = rand() % 10;
+        }
+    }
+
+    Stamp run[2];
+    for (int pass = 0; pass < 2; pass++)
+    {
+        double *out = pass ? Xfix : X;
+        smallKernels = pass;
+        Stamp t1 = stampNow();
+        for (int s = 0; s < count; s++)
+            linearSolveSeq(&A[s], B + (size_t)s * n, out + (size_t)s * n, NULL, n, ar);
+        run[pass] = stampDiff(t1, stampNow());
+    }
+    smallKernels = 1;
+
+    double speedup = (run[1].wall > 0) ? run[0].wall / run[1].wall : 0;
+    double maxDiff = maxRelDiff(X, Xfix, count * n);
+
+    printf("General: %.0f ns/system | Fixed-size: %.0f ns/system | Speedup: %.2f | Max diff: %.2e\n",
+           run[0].wall * 1e9 / count, run[1].wall * 1e9 / count, speedup, maxDiff);
+
+    fprintf(fp, "%d,%.5f,%.5f,%.2f,%.3e,%.5f,%.5f,%.5f,fixed,,,,,%s,\n",
+            n, run[0].wall, run[1].wall, speedup, maxDiff,
+            run[0].selfCpu, run[1].selfCpu, run[1].childCpu, numaLabel());
+    fflush(fp);
+
+    for (int s = 0; s < count; s++)
+        destroyGrid(&A[s]);
+    free(A);
+    free(B);
+    free(X);
+    free(Xfix);
+}
+
+/*
+ * -R k: k random right-hand sides for one matrix, solved by k calls of
+ * linearSolveSeq (seq, honouring -m), then by linearSolveMulti and by a
+ * SolveStream fed one column at a time (backends "multi" and "stream").
+ */
+static void runMulti(FILE *fp, const Grid *A, int n, int k, ScratchArena *ar)
+{
+    double *cols = malloc((size_t)k * n * sizeof(double));   // k × n, one system per row
+    double *Bm = malloc((size_t)n * k * sizeof(double));     // n × k, as linearSolveMulti takes it
+    double *X = calloc((size_t)k * n, sizeof(double));
+    double *Xm = calloc((size_t)n * k, sizeof(double));
+    double *Xs = calloc((size_t)k * n, sizeof(double));
+
+    for (int c = 0; c < k; c++)
+        for (int i = 0; i < n; i++)
+            cols[(size_t)c * n + i] = Bm[(size_t)i * k + c] = rand() % 10;
+
+    Stamp t1 = stampNow();
+    for (int c = 0; c < k; c++)
+        linearSolveSeq(A, cols + (size_t)c * n, X + (size_t)c * n, NULL, n, ar);
+    Stamp seq = stampDiff(t1, stampNow());
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        t1 = stampNow();
+        if (pass == 0)
+        {
+            linearSolveMulti(A, Bm, Xm, n, k, ar);
+        }
+        else
+        {
+            SolveStream st;
+            solveStreamOpen(&st, A);
+            for (int c = 0; c < k; c++)
+                solveStreamPush(&st, cols + (size_t)c * n, Xs + (size_t)c * n);
+            solveStreamClose(&st);
+        }
+        Stamp par = stampDiff(t1, stampNow());
+
+        /* Bring the n × k result into the k × n order of X */
+        if (pass == 0)
+            for (int c = 0; c < k; c++)
+                for (int i = 0; i < n; i++)
+                    Xs[(size_t)c * n + i] = Xm[(size_t)i * k + c];
+
+        const char *name = pass ? "stream" : "multi";
+        double speedup = (par.wall > 0) ? seq.wall / par.wall : 0;
+        double maxDiff = maxRelDiff(X, Xs, k * n);
+
+        printf("Seq: %.3f sec | Par (%s, %d right-hand sides): %.3f sec | "
+               "Speedup: %.2f | Max diff: %.2e\n",
+               seq.wall, name, k, par.wall, speedup, maxDiff);
+
+        fprintf(fp, "%d,%.5f,%.5f,%.2f,%.3e,%.5f,%.5f,%.5f,%s,,,,,%s,\n",
+                n, seq.wall, par.wall, speedup, maxDiff,
+                seq.selfCpu, par.selfCpu, par.childCpu, name, numaLabel());
+        fflush(fp);
+    }
+
+    free(cols);
+    free(Bm);
+    free(X);
+    free(Xm);
+    free(Xs);
+}
+
+/*
+ * -L reps: time `reps` creations of a child that exits at once with every -C
+ * strategy, while the parent holds an n × n matrix. Each row compares one
+ * strategy (backend "create-<strategy>") with fork: seq_time and par_time are
+ * the seconds per child from creation to reap, for fork and for the strategy.
+ */
+static void runSpawnLatency(FILE *fp, int n, int reps)
+{
+    Grid A = makeGrid(n);   // Touched, so that the page tables to copy grow with n
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+            GRID_ROW(&A, i)[j] = rand() % 10;
+
+    char *argv[] = { WORKER_EXE, "--exit", NULL };
+    Stamp run[SPAWN_MODES];
+    for (int mode = 0; mode < SPAWN_MODES; mode++)
+    {
+        spawnPrepare(mode);
+        Stamp t1 = stampNow();
+        for (int r = 0; r < reps; r++)
+        {
+            pid_t pid = spawnProcess(mode, argv);
+            if (pid == 0)
+                _exit(0);
+            if (pid < 0)
+            {
+                perror(spawnNames[mode]);
+                break;
+            }
+            waitpid(pid, NULL, 0);
+        }
+        run[mode] = stampDiff(t1, stampNow());
+    }
+
+    double forkEach = run[SPAWN_FORK].wall / reps;
+    printf("Process creation:");
+    for (int mode = 0; mode < SPAWN_MODES; mode++)
+    {
+        double each = run[mode].wall / reps;
+        double speedup = (each > 0) ? forkEach / each : 0;
+        printf("%s %s %.1f us", mode ? " |" : "", spawnNames[mode], each * 1e6);
+
+        fprintf(fp, "%d,%.7f,%.7f,%.2f,,%.5f,%.5f,%.5f,create-%s,,,%.7f,,%s,\n",
+                n, forkEach, each, speedup, run[SPAWN_FORK].selfCpu,
+                run[mode].selfCpu, run[mode].childCpu, spawnNames[mode], each, numaLabel());
+    }
+    printf(" (per child, %d children)\n", reps);
+    fflush(fp);
+
+    destroyGrid(&A);
+}
+
+#define BANDWIDTH_BYTES (64 << 20)   /* Buffer per node, well beyond the caches */
+#define BANDWIDTH_REPS  3
+
+static volatile uint64_t bandwidthSink;   /* Keeps the read loop from being optimised away */
+
+/*
+ * -N: read bandwidth of every memory node as seen from the main thread. The
+ * buffer is freshly mapped, bound to one node (MPOL_BIND) and read
+ * BANDWIDTH_REPS times; the best pass counts. Where mbind fails it lands
+ * wherever first touch puts it. One CSV row per node: backend "bandwidth",
+ * size the buffer in MiB, par_time the seconds of the best pass, numa_node the
+ * node and numa_policy "bind" or "first-touch".
+ */
+static void reportNodeBandwidth(FILE *fp)
+{
+    size_t count = BANDWIDTH_BYTES / sizeof(uint64_t);
+    int here = currentNode();
+
+    for (int node = 0; node < NUMA_MAX_NODES; node++)
+    {
+        if (!(numaMask & (1UL << node)))
+            continue;
+
+        uint64_t *buf = mmap(NULL, BANDWIDTH_BYTES, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buf == MAP_FAILED)
+        {
+            perror("mmap");
+            return;
+        }
+        unsigned long mask = 1UL << node;
+        int bound = numaPolicies &&
+                    syscall(SYS_mbind, buf, BANDWIDTH_BYTES, MPOL_BIND, &mask, NUMA_MAX_NODES + 1, 0) == 0;
+        for (size_t i = 0; i < count; i++)
+            buf[i] = i;   // Fault every page in on `node`
+
+        double best = INFINITY;
+        uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;   // Independent sums keep the loads in flight
+        for (int r = 0; r < BANDWIDTH_REPS; r++)
+        {
+            double t0 = wallSeconds();
+            for (size_t i = 0; i < count; i += 4)
+            {
+                s0 += buf[i];
+                s1 += buf[i + 1];
+                s2 += buf[i + 2];
+                s3 += buf[i + 3];
+            }
+            double t = wallSeconds() - t0;
+            best = (t < best) ? t : best;
+        }
+        bandwidthSink = s0 + s1 + s2 + s3;
+
+        printf("Memory node %d: %.2f GB/s read from node %d%s\n", node,
+               BANDWIDTH_BYTES / best / 1e9, here, bound ? "" : " (not bound, first touch)");
+        fprintf(fp, "%d,,%.7f,,,,,,bandwidth,,,,,%s,%d\n",
+                BANDWIDTH_BYTES >> 20, best, bound ? "bind" : "first-touch", node);
+        munmap(buf, BANDWIDTH_BYTES);
+    }
+    fflush(fp);
+}
+
+/*
+ * -T: self-checks against known answers, independent of the backend comparison
+ * that max_diff makes. Prints one line per check and returns the number that
+ * failed (main's exit status).
+ *      exact / modular  integer matrices with a known determinant, one to several
+ *                       limbs, negative and singular
+ *      small kernels    the fixed-size kernels for n = 2..4 against the general LU
+ *                       path, and singular inputs
+ *      batch            linearSolveBatch against linearSolveLU, with a partial lane
+ *                       group, several panels and a singular system in the batch
+ *      mixed            backward error of the refined solution
+ *      DAG              the tiled DAG Cramer solver against seq
+ */
+static int checkFailures;
+
+static void check(int ok, const char *what, int n)
+{
+    printf("%s  %s (n = %d)\n", ok ? "ok  " : "FAIL", what, n);
+    checkFailures += !ok;
+}
+
+/* A = L · U with L unit lower triangular (all ones) and U upper triangular with
+   diagonal diag and small off-diagonal entries, so det(A) = Π diag */
+static Grid checkKnownDet(int n, const double *diag)
+{
+    Grid A = makeGrid(n);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++)
+        {
+            double sum = 0;
+            for (int k = 0; k <= i && k <= j; k++)
+                sum += (k == j) ? diag[k] : (double)((j - k) % 3);
+            GRID_ROW(&A, i)[j] = sum;
+        }
+    return A;
+}
+
+static int bigEquals(const BigInt *x, int sign, const uint64_t *limb, int len)
+{
+    if (x->sign != sign)
+        return 0;
+    if (sign == 0)
+        return 1;
+    return x->len == len && memcmp(x->limb, limb, len * sizeof(uint64_t)) == 0;
+}
+
+static void checkExact(void)
+{
+    /* 2⁶⁴ − 1 = (2³² − 1)(2³² + 1) and 2¹²⁸ − 1 = (2⁶⁴ − 1) · 274177 · 67280421310721 */
+    static const struct
+    {
+        int n;
+        double diag[4];
+        int sign, len;
+        uint64_t limb[2];
+        const char *what;
+    } cases[] = {
+        { 4, { 2, 3, 5, 7 }, 1, 1, { 210 }, "small det" },
+        { 2, { 4294967295.0, 4294967297.0 }, 1, 1, { UINT64_MAX }, "det 2^64 - 1" },
+        { 2, { -4294967295.0, 4294967297.0 }, -1, 1, { UINT64_MAX }, "det -(2^64 - 1)" },
+        { 4, { 4294967295.0, 4294967297.0, 274177, 67280421310721.0 }, 1, 2,
+          { UINT64_MAX, UINT64_MAX }, "det 2^128 - 1" },
+    };
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        char what[80];
+        Grid A = checkKnownDet(cases[c].n, cases[c].diag);
+        BigInt e = calcExactDet(&A, NULL, -1), m = calcModularDet(&A, NULL, -1);
+
+        snprintf(what, sizeof(what), "exact %s", cases[c].what);
+        check(bigEquals(&e, cases[c].sign, cases[c].limb, cases[c].len), what, cases[c].n);
+        snprintf(what, sizeof(what), "modular %s", cases[c].what);
+        check(bigEquals(&m, cases[c].sign, cases[c].limb, cases[c].len), what, cases[c].n);
+        bigFree(&e);
+        bigFree(&m);
+        destroyGrid(&A);
+    }
+
+    /* Two equal rows */
+    Grid S = makeGrid(5);
+    for (int i = 0; i < 5; i++)
+        for (int j = 0; j < 5; j++)
+            GRID_ROW(&S, i)[j] = (i == 3) ? GRID_ROW(&S, 1)[j] : rand() % 10;
+    BigInt e = calcExactDet(&S, NULL, -1), m = calcModularDet(&S, NULL, -1);
+    check(e.sign == 0, "exact singular", 5);
+    check(m.sign == 0, "modular singular", 5);
+    bigFree(&e);
+    bigFree(&m);
+    destroyGrid(&S);
+}
+
+/* magDivExact on all-ones limbs, where a step's carry reaches 2⁶⁴ − 1 */
+static void checkDivExact(void)
+{
+    uint64_t q[4], b[4], a[8], r[8];
+    for (int lq = 1; lq <= 4; lq++)
+        for (int lb = 1; lb <= 4; lb++)
+        {
+            for (int i = 0; i < 4; i++)
+                q[i] = b[i] = UINT64_MAX;
+            int la = magMul(a, q, lq, b, lb);
+            int lr = magDivExact(r, a, la, b, lb, limbInverse(b[0]));
+            check(lr == lq && memcmp(r, q, lq * sizeof(uint64_t)) == 0, "exact division, all-ones limbs",
+                  lq * 10 + lb);
+        }
+}
+
+static void checkSmall(ScratchArena *ar)
+{
+    for (int n = 2; n <= 4; n++)
+    {
+        Grid A = makeGrid(n), G = makeGrid(n);
+        double B[4], X[4], Y[4];
+        for (int i = 0; i < n; i++)
+        {
+            B[i] = rand() % 10;
+            for (int j = 0; j < n; j++)
+                GRID_ROW(&A, i)[j] = rand() % 10 + (i == j ? 10 : 0);   // Diagonally dominant
+        }
+
+        memset(X, 0, sizeof(X));
+        memset(Y, 0, sizeof(Y));
+        smallCramer[n](&A, B, X, NULL);
+        linearSolveLU(&A, B, Y, NULL, n, ar);
+        check(maxRelDiff(X, Y, n) < 1e-12, "small kernel vs LU", n);
+
+        cloneGrid(&A, &G);
+        double det = logDetValue(luFactor(&G, luBlock, NULL, NULL));
+        check(fabs(smallDet[n](&A) - det) <= 1e-12 * fabs(det), "small det vs LU", n);
+
+        for (int j = 0; j < n; j++)
+            GRID_ROW(&A, n - 1)[j] = GRID_ROW(&A, 0)[j] + (j == 0 ? 1e-11 : 0);   // Near-singular
+        cloneGrid(&A, &G);
+        LogDet near = luFactor(&G, luBlock, NULL, NULL);
+        check((smallDet[n](&A) == 0) == (near.sign == 0) &&
+              (smallCramer[n](&A, B, X, NULL) == 0) == (near.sign == 0),
+              "small near-singular agrees with LU", n);
+
+        for (int j = 0; j < n; j++)
+            GRID_ROW(&A, n - 1)[j] = GRID_ROW(&A, 0)[j];   // Singular: two equal rows
+        check(smallDet[n](&A) == 0 && smallCramer[n](&A, B, X, NULL) == 0, "small singular", n);
+
+        destroyGrid(&A);
+        destroyGrid(&G);
+    }
+}
+
+static void checkBatch(ScratchArena *ar)
+{
+    const int count = BATCH_LANES_MAX + 5;   // One full lane group and a partial one
+    const int sizes[] = { 3, 8, 2 * BATCH_PANEL + 5 };   // Last: panels and a short tail
+    for (size_t t = 0; t < sizeof(sizes) / sizeof(sizes[0]); t++)
+    {
+        int n = sizes[t];
+        SystemBatch sb;
+        double *B = malloc((size_t)count * n * sizeof(double));
+        double *X = calloc((size_t)count * n, sizeof(double));
+        double *Y = calloc((size_t)count * n, sizeof(double));
+        int singularAgree = 1;
+
+        batchInit(&sb, n, count);
+        for (int s = 0; s < count; s++)
+        {
+            Grid A = makeGrid(n);
+            for (int i = 0; i < n; i++)
+            {
+                B[(size_t)s * n + i] = rand() % 10;
+                for (int j = 0; j < n; j++)
+                    GRID_ROW(&A, i)[j] = (s == 2 && i == 1) ? GRID_ROW(&A, 0)[j] : rand() % 10;
+            }
+            batchSetSystem(&sb, s, &A, B + (size_t)s * n);
+            LUFactor f = luDecompose(&A, arenaGrid(ar, 0, n));
+            if (f.det.sign != 0)
+                luSolve(&f, B + (size_t)s * n, Y + (size_t)s * n);
+            singularAgree &= (s != 2 || f.det.sign == 0);
+            luRelease(&f);
+            destroyGrid(&A);
+        }
+
+        linearSolveBatch(&sb);
+        for (int s = 0; s < count; s++)
+        {
+            double det = batchGetSolution(&sb, s, X + (size_t)s * n);
+            singularAgree &= (s != 2 || det == 0);
+            if (det == 0)   // Compare solutions of the regular systems only
+                memset(X + (size_t)s * n, 0, n * sizeof(double));
+        }
+        check(maxRelDiff(X, Y, count * n) < 1e-9, "batch vs LU", n);
+        check(singularAgree, "batch singular system", n);
+
+        batchFree(&sb);
+        free(B);
+        free(X);
+        free(Y);
+    }
+}
+
+/* calcLogDetReplaced against cloneGrid + swapColumn + calcLogDet; A must stay untouched */
+static void checkReplaced(ScratchArena *ar)
+{
+    int n = 40;
+    Grid A = makeGrid(n), G = makeGrid(n), keep = makeGrid(n);
+    double *B = malloc(n * sizeof(double));
+    for (int i = 0; i < n; i++)
+    {
+        B[i] = rand() % 10;
+        for (int j = 0; j < n; j++)
+            GRID_ROW(&A, i)[j] = rand() % 10;
+    }
+    cloneGrid(&A, &keep);
+
+    int agree = 1;
+    for (int col = -1; col < n; col += 7)
+    {
+        cloneGrid(&A, &G);
+        if (col >= 0)
+            swapColumn(&G, B, col);
+        LogDet want = calcLogDet(&G), got = calcLogDetReplaced(&A, B, col, arenaGrid(ar, 0, n));
+        agree &= got.sign == want.sign && (got.sign == 0 || fabs(got.logAbs - want.logAbs) < 1e-10);
+    }
+    check(agree, "column-replaced view vs copy", n);
+    check(memcmp(A.data, keep.data, (size_t)n * A.ld * sizeof(double)) == 0,
+          "column-replaced view leaves A alone", n);
+
+    destroyGrid(&A);
+    destroyGrid(&G);
+    destroyGrid(&keep);
+    free(B);
+}
+
+/* Backward error of the refined solution on a random 48 × 48 system */
+static void checkMixed(ScratchArena *ar)
+{
+    int n = 48;
+    Grid A = makeGrid(n);
+    double *B = malloc(n * sizeof(double));
+    double *X = calloc(n, sizeof(double));
+    for (int i = 0; i < n; i++)
+    {
+        B[i] = rand() % 10;
+        for (int j = 0; j < n; j++)
+            GRID_ROW(&A, i)[j] = rand() % 10;
+    }
+
+    linearSolveMixed(&A, B, X, NULL, n, ar);
+    check(lastRefine.iters >= 0 && lastRefine.residual <= sqrt((double)n) * DBL_EPSILON,
+          "mixed backward error", n);
+
+    destroyGrid(&A);
+    free(B);
+    free(X);
+}
+
+/* DAG against seq in Cramer mode. With 16-wide tiles the (n − 1)-sized trailing
+   systems split into 3 × 3 tiles, so TRSM and GEMM tasks run, not one TASK_PANEL. */
+static void checkDag(ScratchArena *ar)
+{
+    int n = 48;
+    Grid A = makeGrid(n);
+    double *B = malloc(n * sizeof(double));
+    double *X = calloc(n, sizeof(double));
+    double *Y = calloc(n, sizeof(double));
+    for (int i = 0; i < n; i++)
+    {
+        B[i] = rand() % 10;
+        for (int j = 0; j < n; j++)
+            GRID_ROW(&A, i)[j] = rand() % 10;
+    }
+
+    int mode = solveMode, block = luBlock;
+    solveMode = SOLVE_CRAMER;
+    luBlock = 16;
+    linearSolveSeq(&A, B, X, NULL, n, ar);
+    linearSolveDag(&A, B, Y, NULL, n, ar);
+    solveMode = mode;
+    luBlock = block;
+    check(maxRelDiff(X, Y, n) < 1e-10, "DAG vs seq", n);
+
+    destroyGrid(&A);
+    free(B);
+    free(X);
+    free(Y);
+}
+
+static int runChecks(void)
+{
+    ScratchArena ar;
+    arenaInit(&ar);
+    srand(1);   // Fixed inputs, so a failure can be reproduced
+
+    checkExact();
+    checkDivExact();
+    checkSmall(&ar);
+    checkBatch(&ar);
+    checkReplaced(&ar);
+    checkMixed(&ar);
+    checkDag(&ar);
+
+    arenaRelease(&ar);
+    schedStop();
+    if (teamReady)
+        teamStop(&team);
+    printf("%d check(s) failed\n", checkFailures);
+    return checkFailures;
+}
+
+int main(int argc, char *argv[])
+{
+    /* The worker and latency probe started by vfork / spawn (see spawnProcess) */
+    if (argc == 7 && strcmp(argv[1], "--worker") == 0)
+        return preforkExecWorker(argv + 1);
+    if (argc == 2 && strcmp(argv[1], "--exit") == 0)
+        return 0;
+
+    int opt;
+    const char *kernelName = NULL;
+    int backends = BACKEND_FORK;
+    int batchCount = 0;
+    int rhsCount = 0;
+    int fixedCount = 0;
+    int latencyReps = 0;
+    int selfCheck = 0;
+    int badOption = 0;   // Unknown option or value: print the usage message and stop
+    while ((opt = getopt(argc, argv, "b:k:m:p:B:t:dP:S:R:F:C:L:A:NT")) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            luBlock = atoi(optarg);
+            break;
+        case 'k':
+            kernelName = optarg;
+            break;
+        case 'm':
+            if (strcmp(optarg, "lu") == 0)
+                solveMode = SOLVE_LU;
+            else if (strcmp(optarg, "rank1") == 0)
+                solveMode = SOLVE_RANK1;
+            else if (strcmp(optarg, "exact") == 0)
+                solveMode = SOLVE_EXACT;
+            else if (strcmp(optarg, "modular") == 0)
+                solveMode = SOLVE_MODULAR;
+            else if (strcmp(optarg, "mixed") == 0)
+                solveMode = SOLVE_MIXED;
+            else if (strcmp(optarg, "cramer") == 0)
+                solveMode = SOLVE_CRAMER;
+            else
+                badOption = 1;
+            break;
+        case 'p':
+            workerCount = atoi(optarg);
+            break;
+        case 't':
+            detThreads = atoi(optarg);
+            break;
+        case 'd':
+            dagLU = 1;
+            break;
+        case 'P':
+            if (strcmp(optarg, "none") == 0)
+                pivotMode = PIVOT_NONE;
+            else if (strcmp(optarg, "complete") == 0)
+                pivotMode = PIVOT_COMPLETE;
+            else if (strcmp(optarg, "rook") == 0)
+                pivotMode = PIVOT_ROOK;
+            else if (strcmp(optarg, "partial") == 0)
+                pivotMode = PIVOT_PARTIAL;
+            else
+                badOption = 1;
+            break;
+        case 'S':
+            batchCount = atoi(optarg);
+            break;
+        case 'R':
+            rhsCount = atoi(optarg);
+            break;
+        case 'F':
+            fixedCount = atoi(optarg);
+            break;
+        case 'C':
+            spawnMode = -1;
+            for (int m = 0; m < SPAWN_MODES; m++)
+                if (strcmp(optarg, spawnNames[m]) == 0)
+                    spawnMode = m;
+            if (spawnMode < 0)
+            {
+                spawnMode = SPAWN_FORK;
+                badOption = 1;
+            }
+            break;
+        case 'L':
+            latencyReps = atoi(optarg);
+            break;
+        case 'N':
+            numaPolicies = 1;
+            break;
+        case 'T':
+            selfCheck = 1;
+            break;
+        case 'A':
+            placeMode = -1;
+            for (int m = 0; m < PLACE_MODES; m++)
+                if (strcmp(optarg, placeNames[m]) == 0)
+                    placeMode = m;
+            if (placeMode < 0)
+            {
+                placeMode = PLACE_NONE;
+                badOption = 1;
+            }
+            break;
+        case 'B':
+            if (strcmp(optarg, "threads") == 0)
+                backends = BACKEND_THREADS;
+            else if (strcmp(optarg, "dag") == 0)
+                backends = BACKEND_DAG;
+            else if (strcmp(optarg, "both") == 0)
+                backends = BACKEND_FORK | BACKEND_THREADS;
+            else if (strcmp(optarg, "prefork") == 0)
+                backends = BACKEND_PREFORK;
+            else if (strcmp(optarg, "all") == 0)
+                backends = BACKEND_FORK | BACKEND_THREADS | BACKEND_DAG | BACKEND_PREFORK;
+            else if (strcmp(optarg, "fork") == 0)
+                backends = BACKEND_FORK;
+            else
+                badOption = 1;
+            break;
+        default:
+            badOption = 1;   // getopt has already named the option
+        }
+    }
+
+    if (!badOption && selfCheck)
+    {
+        selectKernels(kernelName);
+        return runChecks() ? 1 : 0;
+    }
+    if (badOption || optind >= argc)
+    {
+        printf("Usage: %s [-b block] [-k kernel] [-m cramer|lu|rank1|exact|modular|mixed] [-p procs] [-B fork|threads|dag|prefork|both|all] [-t threads] [-d] [-P none|partial|complete|rook] [-S count] [-R rhs] [-F count] [-C fork|vfork|spawn|clone] [-L reps] [-A none|compact|scatter|physical|nosmt] [-N] [-T] size1 size2 size3 ...\n", argv[0]);
+        return 1;
+    }
+    if (luBlock < 1)
+        luBlock = LU_BLOCK_DEFAULT;
+
+    selectKernels(kernelName);
+    const char *modeNames[] = { "Cramer", "single-factorization", "rank-one update", "exact integer",
+                                "multi-modular", "mixed-precision" };
+    printf("Using %s kernels, LU block %d, %s mode\n", kern.name, luBlock, modeNames[solveMode]);
+
+    /* Where worker w of every backend runs, for the CSV */
+    placementInit();
+    char placement[256];
+    int seats = poolSize(1 << 30);
+    placeDescribe(placement, sizeof(placement), (detThreads > seats) ? detThreads : seats);
+    if (placeCount > 0)
+        printf("Workers pinned as %s\n", placement);
+    if (numaPolicies)
+        printf("NUMA policies over %d memory node(s)\n", numaInit());
+
+    /* Open CSV file in current working directory */
+    FILE *fp = fopen("results.csv", "w");
+    if (!fp)
+    {
+        perror("Error opening results.csv");
+        return 1;
+    }
+
+    fprintf(fp, "size,seq_time,par_time,speedup,max_diff,seq_cpu,par_cpu,par_child_cpu,backend,"
+                "refine_iter,residual,spawn_time,placement,numa_policy,numa_node\n");
+    fflush(fp);  // Flush header before any fork occurs
+    if (numaPolicies)
+        reportNodeBandwidth(fp);
+
+    srand(time(NULL));  // Seed random generator
+
+    /* One arena for the whole sweep: scratch buffers are reused across sizes */
+    ScratchArena arena;
+    arenaInit(&arena);
+
+    /* The prefork pool is started once, with room for the largest size */
+    for (int arg = optind; arg < argc; arg++)
+        preforkReserve(atoi(argv[arg]));
+
+    for (int arg = optind; arg < argc; arg++)
+    {
+        int n = atoi(argv[arg]);
+        printf("\nRunning for matrix size %d\n", n);
+
+        if (batchCount > 0)
+        {
+            runBatch(fp, n, batchCount, &arena);
+            continue;
+        }
+        if (fixedCount > 0)
+        {
+            runFixed(fp, n, fixedCount, &arena);
+            continue;
+        }
+        if (latencyReps > 0)
+        {
+            runSpawnLatency(fp, n, latencyReps);
+            continue;
+        }
+
+        /* Allocate matrix and vectors; every worker reads A, so -N interleaves it */
+        Grid A = makeGridFor(n, MEM_SHARED);
+        double *B = malloc(n * sizeof(double));
+        double *X = calloc(n, sizeof(double));
+        double *Xpar = calloc(n, sizeof(double));
+
+        /* Fill matrix with random values */
+        for (int i = 0; i < n; i++)
+        {
+            B[i] = rand() % 10;
+            for (int j = 0; j < n; j++)
+                GRID_ROW(&A, i)[j] = rand() % 10;
+        }
+
+        if (rhsCount > 0)
+        {
+            runMulti(fp, &A, n, rhsCount, &arena);
+            destroyGrid(&A);
+            free(B);
+            free(X);
+            free(Xpar);
+            continue;
+        }
+
+        /* Sequential timing */
+        Stamp t1 = stampNow();
+        linearSolveSeq(&A, B, X, NULL, n, &arena);
+        Stamp seq = stampDiff(t1, stampNow());
+
+        fflush(fp);  // Flush before fork to avoid duplicate buffer writes
+
+        for (int backend = BACKEND_FORK; backend <= BACKEND_PREFORK; backend <<= 1)
+        {
+            if (!(backends & backend))
+                continue;
+
+            /* Parallel timing */
+            memset(Xpar, 0, n * sizeof(double));
+            spawnSeconds = 0;
+            t1 = stampNow();
+            if (backend == BACKEND_THREADS)
+                linearSolveThreads(&A, B, Xpar, NULL, n, &arena);
+            else if (backend == BACKEND_DAG)
+                linearSolveDag(&A, B, Xpar, NULL, n, &arena);
+            else if (backend == BACKEND_PREFORK)
+                linearSolvePrefork(&A, B, Xpar, NULL, n, &arena);
+            else
+                linearSolvePar(&A, B, Xpar, NULL, n, &arena);
+            Stamp par = stampDiff(t1, stampNow());
+
+            double speedup = (par.wall > 0) ? seq.wall / par.wall : 0;
+            double maxDiff = maxRelDiff(X, Xpar, n);
+            int refine = (solveMode == SOLVE_MIXED) ? lastRefine.iters : 0;
+            double residual = relResidual(&A, B, Xpar, n);
+            int spawns = (backend == BACKEND_FORK || backend == BACKEND_PREFORK);
+            char label[32];   // e.g. "fork-vfork" when -C is not fork
+            snprintf(label, sizeof(label), (spawns && spawnMode != SPAWN_FORK) ? "%s-%s" : "%s",
+                     backendName(backend), spawnNames[spawnMode]);
+
+            printf("Seq: %.3f sec | Par (%s): %.3f sec (cpu %.3f parent + %.3f children) | "
+                   "Speedup: %.2f | Max diff: %.2e\n",
+                   seq.wall, label, par.wall, par.selfCpu, par.childCpu,
+                   speedup, maxDiff);
+            if (solveMode == SOLVE_MIXED)
+                printf("Refinement: %d steps%s, backward error %.2e\n", refine,
+                       refine < 0 ? " (fell back to double)" : "", residual);
+            if (spawns)
+                printf("Process creation: %.3f ms of the parallel time\n", spawnSeconds * 1e3);
+
+            fprintf(fp, "%d,%.5f,%.5f,%.2f,%.3e,%.5f,%.5f,%.5f,%s,%d,%.3e,%.6f,%s,%s,\n",
+                    n, seq.wall, par.wall, speedup, maxDiff,
+                    seq.selfCpu, par.selfCpu, par.childCpu, label,
+                    refine, residual, spawnSeconds, placement, numaLabel());
+            fflush(fp);  // Ensure data is written safely
+        }
 
-        destroyGrid(A, n);
+        destroyGrid(&A);
         free(B);
         free(X);
+        free(Xpar);
     }
 
+    if (teamReady)
+        teamStop(&team);
+    schedStop();
+    preforkStop();
+    arenaRelease(&arena);
     fclose(fp);
     printf("\nResults saved to results.csv\n");
     return 0;
@@ -1,133 +1,249 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 
 #define LIMIT_PROC 8
 
 // MATRIX MEMORY SECTION
+// One 64-byte aligned buffer per matrix, rows padded to a multiple of 8 doubles
 
-double **makeGrid(int dim)
+#define GRID_ALIGN 64
+#define GRID_PAD (GRID_ALIGN / (int)sizeof(double))
+
+typedef struct
+{
+    double *data;
+    int n;
+    int ld;
+} Grid;
+
+#define GRID_ROW(g, r) ((g)->data + (size_t)(r) * (g)->ld)
+
+Grid makeGrid(int dim)
 {
-    double **grid = malloc(dim * sizeof(double *));
-    for (int r = 0; r < dim; r++)
-        grid[r] = malloc(dim * sizeof(double));
+    Grid grid;
+    int rows = dim > 0 ? dim : 1;
+    grid.n = dim;
+    grid.ld = (rows + GRID_PAD - 1) / GRID_PAD * GRID_PAD;
+    grid.data = aligned_alloc(GRID_ALIGN, (size_t)grid.ld * rows * sizeof(double));
+    if (!grid.data)
+    {
+        perror("makeGrid");
+        exit(1);
+    }
     return grid;
 }
 
-void destroyGrid(double **grid, int dim)
+void destroyGrid(Grid *grid)
 {
-    for (int r = 0; r < dim; r++)
-        free(grid[r]);
-    free(grid);
+    free(grid->data);
+    grid->data = NULL;
 }
 
-void cloneGrid(double **src, double **dest, int dim)
+void cloneGrid(const Grid *src, Grid *dest)
 {
-    for (int r = 0; r < dim; r++)
-        for (int c = 0; c < dim; c++)
-            dest[r][c] = src[r][c];
+    if (src->ld == dest->ld)
+    {
+        memcpy(dest->data, src->data, (size_t)src->n * src->ld * sizeof(double));
+        return;
+    }
+    for (int r = 0; r < src->n; r++)
+        memcpy(GRID_ROW(dest, r), GRID_ROW(src, r), src->n * sizeof(double));
 }
 
-void swapColumn(double **grid, double *vec, int colIndex, int dim)
+void swapColumn(Grid *grid, const double *vec, int colIndex)
 {
-    for (int r = 0; r < dim; r++)
-        grid[r][colIndex] = vec[r];
+    for (int r = 0; r < grid->n; r++)
+        GRID_ROW(grid, r)[colIndex] = vec[r];
 }
 
 // DETERMINANT SECTION
+// Partial pivoting: bring the largest element of column i up, each swap flips the sign
+// The result is kept as sign and log|det|, a plain product overflows for large n
+
+typedef struct
+{
+    int sign;        // 0 for a singular matrix
+    double logAbs;
+} LogDet;
 
-double calcDet(double **grid, int dim)
+LogDet calcLogDet(Grid *grid)
 {
-    double result = 1.0;
+    int dim = grid->n;
+    LogDet result = { 1, 0.0 };
+    LogDet zero = { 0, 0.0 };
 
     for (int i = 0; i < dim; i++)
     {
-        if (fabs(grid[i][i]) < 1e-9)
-            return 0;
+        int best = i;
+        for (int j = i + 1; j < dim; j++)
+            if (fabs(GRID_ROW(grid, j)[i]) > fabs(GRID_ROW(grid, best)[i]))
+                best = j;
+
+        double *pivotRow = GRID_ROW(grid, i);
+        if (fabs(GRID_ROW(grid, best)[i]) < 1e-9)
+            return zero;
+
+        if (best != i)
+        {
+            double *other = GRID_ROW(grid, best);
+            for (int k = i; k < dim; k++)
+            {
+                double t = pivotRow[k];
+                pivotRow[k] = other[k];
+                other[k] = t;
+            }
+            result.sign = -result.sign;
+        }
 
         for (int j = i + 1; j < dim; j++)
         {
-            double factor = grid[j][i] / grid[i][i];
-            for (int k = 0; k < dim; k++)
-                grid[j][k] -= factor * grid[i][k];
+            double *row = GRID_ROW(grid, j);
+            double factor = row[i] / pivotRow[i];
+            for (int k = i; k < dim; k++)
+                row[k] -= factor * pivotRow[k];
         }
-        result *= grid[i][i];
+        if (pivotRow[i] < 0)
+            result.sign = -result.sign;
+        result.logAbs += log(fabs(pivotRow[i]));
     }
     return result;
 }
 
+// detVar / mainDet without forming either determinant
+double detRatio(LogDet detVar, LogDet mainDet)
+{
+    return detVar.sign * mainDet.sign * exp(detVar.logAbs - mainDet.logAbs);
+}
+
 // SEQUENTIAL CRAMER SECTION
+// One scratch matrix per solve, refilled for every determinant
 
-void linearSolveSeq(double **coeff, double *constVec, double *solVec, int dim)
+void linearSolveSeq(const Grid *coeff, double *constVec, double *solVec, int dim)
 {
-    double **tmp = makeGrid(dim);
-    cloneGrid(coeff, tmp, dim);
+    Grid tmp = makeGrid(dim);
+    cloneGrid(coeff, &tmp);
 
-    double mainDet = calcDet(tmp, dim);
-    destroyGrid(tmp, dim);
+    LogDet mainDet = calcLogDet(&tmp);
 
-    if (mainDet == 0)
+    if (mainDet.sign == 0)
     {
         printf("No unique solution\n");
+        destroyGrid(&tmp);
         return;
     }
 
     for (int var = 0; var < dim; var++)
     {
-        tmp = makeGrid(dim);
-        cloneGrid(coeff, tmp, dim);
+        cloneGrid(coeff, &tmp);
 
-        swapColumn(tmp, constVec, var, dim);
-        double detVar = calcDet(tmp, dim);
+        swapColumn(&tmp, constVec, var);
+        LogDet detVar = calcLogDet(&tmp);
 
-        solVec[var] = detVar / mainDet;
-        destroyGrid(tmp, dim);
+        solVec[var] = detRatio(detVar, mainDet);
     }
+    destroyGrid(&tmp);
 }
 
 //PARALLEL CRAMER SECTION
 
-void linearSolvePar(double **coeff, double *constVec, double *solVec, int dim)
+void linearSolvePar(const Grid *coeff, double *constVec, double *solVec, int dim)
 {
-    double **tmp = makeGrid(dim);
-    cloneGrid(coeff, tmp, dim);
+    Grid tmp = makeGrid(dim);
+    cloneGrid(coeff, &tmp);
 
-    double mainDet = calcDet(tmp, dim);
-    destroyGrid(tmp, dim);
+    LogDet mainDet = calcLogDet(&tmp);
 
-    if (mainDet == 0)
+    if (mainDet.sign == 0)
     {
         printf("No unique solution\n");
+        destroyGrid(&tmp);
         return;
     }
 
-    for (int var = 0; var < dim; var++)
+    // children write into a shared mapping; their own copy of solVec is private
+    double *shared = mmap(NULL, dim * sizeof(double), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+    {
+        perror("mmap");
+        destroyGrid(&tmp);
+        return;
+    }
+
+    // at most LIMIT_PROC children; child w takes columns w, w + workers, ...
+    int workers = dim < LIMIT_PROC ? dim : LIMIT_PROC;
+    int started = 0;
+
+    for (int w = 0; w < workers; w++)
     {
         pid_t proc = fork();
 
         if (proc == 0)
         {
-            double **localGrid = makeGrid(dim);
-            cloneGrid(coeff, localGrid, dim);
-
-            swapColumn(localGrid, constVec, var, dim);
-            double detVar = calcDet(localGrid, dim);
+            // child reuses its copy of the parent's scratch matrix
+            for (int var = w; var < dim; var += workers)
+            {
+                cloneGrid(coeff, &tmp);
 
-            solVec[var] = detVar / mainDet;
+                swapColumn(&tmp, constVec, var);
+                LogDet detVar = calcLogDet(&tmp);
 
-            destroyGrid(localGrid, dim);
-            exit(0);
+                shared[var] = detRatio(detVar, mainDet);
+            }
+            _exit(0);
         }
+        if (proc < 0)
+        {
+            perror("fork");
+            break;
+        }
+        started++;
     }
 
-    for (int i = 0; i < dim; i++)
+    // columns of children that could not be forked are computed here, so a
+    // short pool still returns every Xi
+    for (int var = 0; var < dim; var++)
+    {
+        if (var % workers < started)
+            continue;
+        cloneGrid(coeff, &tmp);
+        swapColumn(&tmp, constVec, var);
+        shared[var] = detRatio(calcLogDet(&tmp), mainDet);
+    }
+
+    for (int i = 0; i < started; i++)
         wait(NULL);
+
+    memcpy(solVec, shared, dim * sizeof(double));
+    munmap(shared, dim * sizeof(double));
+    destroyGrid(&tmp);
 }
 
 //MAIN DRIVER SECTION
+// clock() misses the children's CPU time, so report wall time (speedup) and
+// the CPU time of reaped children separately
+
+double wallNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double childCpuNow()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_CHILDREN, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+           ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
 
 int main()
 {
@@ -137,39 +253,48 @@ int main()
 
     srand(time(NULL));
 
-    double **matrixA = makeGrid(size);
+    Grid matrixA = makeGrid(size);
     double *vectorB = malloc(size * sizeof(double));
-    double *resultX = malloc(size * sizeof(double));
+    double *resultX = calloc(size, sizeof(double));
+    double *parX = calloc(size, sizeof(double));
 
     for (int i = 0; i < size; i++)
     {
         vectorB[i] = rand() % 10;
         for (int j = 0; j < size; j++)
-            matrixA[i][j] = rand() % 10;
+            GRID_ROW(&matrixA, i)[j] = rand() % 10;
     }
 
     printf("\nSequential Solver Running...\n");
-    clock_t t1 = clock();
-    linearSolveSeq(matrixA, vectorB, resultX, size);
-    clock_t t2 = clock();
+    double t1 = wallNow();
+    linearSolveSeq(&matrixA, vectorB, resultX, size);
+    double t2 = wallNow();
 
-    double seqDuration = (double)(t2 - t1) / CLOCKS_PER_SEC;
+    double seqDuration = t2 - t1;
     printf("Sequential Time: %f sec\n", seqDuration);
 
     printf("\nParallel Solver Running...\n");
-    t1 = clock();
-    linearSolvePar(matrixA, vectorB, resultX, size);
-    t2 = clock();
+    double c1 = childCpuNow();
+    t1 = wallNow();
+    linearSolvePar(&matrixA, vectorB, parX, size);
+    t2 = wallNow();
 
-    double parDuration = (double)(t2 - t1) / CLOCKS_PER_SEC;
-    printf("Parallel Time: %f sec\n", parDuration);
+    double parDuration = t2 - t1;
+    printf("Parallel Time: %f sec (children CPU: %f sec)\n", parDuration, childCpuNow() - c1);
 
     if (parDuration > 0)
         printf("Speedup: %f\n", seqDuration / parDuration);
 
-    destroyGrid(matrixA, size);
+    double maxDiff = 0;
+    for (int i = 0; i < size; i++)
+        if (fabs(resultX[i] - parX[i]) > maxDiff)
+            maxDiff = fabs(resultX[i] - parX[i]);
+    printf("Max difference seq vs par: %e\n", maxDiff);
+
+    destroyGrid(&matrixA);
     free(vectorB);
     free(resultX);
+    free(parX);
 
     printf("\nExecution Completed.\n");
     return 0;